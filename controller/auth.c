@@ -0,0 +1,111 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller message authentication
+ *
+ * Every SED's MAC key is derived from the deployment secret and its SCEWL ID.
+ * Deriving a key costs several hash compressions, so keys of senders that
+ * have already been heard from are kept precomputed in a small direct-mapped
+ * cache and each message only pays for its own MAC
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "auth.h"
+#include "secrets.h"
+
+// domain separation label for sender keys
+#define SENDER_LABEL "SCEWL sender key"
+
+// deployment-wide secret, see secrets.h
+static const uint8_t deploy_secret[SHA256_DIGEST_SZ] = DEPLOY_SECRET;
+
+// deployment secret and this device's key, precomputed
+static hmac_sha256_key_t deploy_key;
+static hmac_sha256_key_t own_key;
+
+// verified senders
+auth_sender_t senders[AUTH_CACHE_SZ];
+
+
+// derive the MAC key of a SED
+static void derive_key(scewl_id_t id, hmac_sha256_key_t *key) {
+  hmac_sha256_ctx_t ctx;
+  uint8_t raw[SHA256_DIGEST_SZ];
+
+  hmac_sha256_init_key(&ctx, &deploy_key);
+  hmac_sha256_update(&ctx, SENDER_LABEL, sizeof(SENDER_LABEL) - 1);
+  hmac_sha256_update(&ctx, &id, sizeof(id));
+  hmac_sha256_final(&ctx, raw);
+
+  hmac_sha256_key(key, raw, sizeof(raw));
+  memset(raw, 0, sizeof(raw));
+}
+
+
+void auth_init(void) {
+  hmac_sha256_key(&deploy_key, deploy_secret, sizeof(deploy_secret));
+  derive_key(SCEWL_ID, &own_key);
+  auth_flush();
+}
+
+
+void auth_flush(void) {
+  memset(senders, 0, sizeof(senders));
+}
+
+
+HOT const hmac_sha256_key_t *auth_sender_key(scewl_id_t src_id) {
+  auth_sender_t *sender = &senders[src_id & (AUTH_CACHE_SZ - 1)];
+
+  // miss, or the slot belongs to another sender
+  if (!sender->valid || sender->id != src_id) {
+    derive_key(src_id, &sender->key);
+    sender->id = src_id;
+    sender->valid = 1;
+  }
+
+  return &sender->key;
+}
+
+
+HOT void auth_tag(const hmac_sha256_key_t *key, const scewl_hdr_t *hdr,
+                  const void *sec, const void *body, uint16_t len, uint8_t *tag) {
+  hmac_sha256_ctx_t ctx;
+  uint8_t mac[SHA256_DIGEST_SZ];
+
+  hmac_sha256_init_key(&ctx, key);
+  hmac_sha256_update(&ctx, &hdr->tgt_id, sizeof(hdr->tgt_id));
+  hmac_sha256_update(&ctx, &hdr->src_id, sizeof(hdr->src_id));
+  hmac_sha256_update(&ctx, &hdr->len, sizeof(hdr->len));
+  hmac_sha256_update(&ctx, sec, sizeof(scewl_sec_hdr_t));
+  hmac_sha256_update(&ctx, body, len);
+  hmac_sha256_final(&ctx, mac);
+
+  memcpy(tag, mac, AUTH_TAG_SZ);
+}
+
+
+void auth_sign(const scewl_hdr_t *hdr, const void *sec, const void *body,
+               uint16_t len, uint8_t *tag) {
+  auth_tag(&own_key, hdr, sec, body, len, tag);
+}
+
+
+HOT int auth_verify(const scewl_hdr_t *hdr, const char *data, uint16_t len) {
+  uint8_t tag[AUTH_TAG_SZ];
+  const char *body = data + sizeof(scewl_sec_hdr_t);
+  uint8_t diff = 0;
+
+  auth_tag(auth_sender_key(hdr->src_id), hdr, data, body, len, tag);
+
+  // compare without an early exit
+  for (int i = 0; i < AUTH_TAG_SZ; i++) {
+    diff |= tag[i] ^ (uint8_t)body[len + i];
+  }
+  return !diff;
+}
+
@@ -0,0 +1,110 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller message authentication header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef AUTH_H
+#define AUTH_H
+
+#include "controller.h"
+#include "sha256.h"
+
+#include <stdint.h>
+
+// bytes of HMAC-SHA-256 kept as the tag at the end of each radio message
+#define AUTH_TAG_SZ 16
+
+// number of verified senders cached at once (must be a power of 2)
+#define AUTH_CACHE_SZ 16
+
+// verified sender credentials
+typedef struct auth_sender_t {
+  scewl_id_t id;
+  uint16_t   valid;
+  hmac_sha256_key_t key;  // sender's MAC key, precomputed
+} auth_sender_t;
+
+
+/*
+ * auth_init
+ *
+ * Loads the deployment secret and derives this device's own MAC key. Must be
+ * called before any other auth function
+ */
+void auth_init(void);
+
+
+/*
+ * auth_flush
+ *
+ * Forgets all verified senders
+ */
+void auth_flush(void);
+
+
+/*
+ * auth_sender_key
+ *
+ * Gets the MAC key of a sender, deriving and caching it on first contact
+ *
+ * Args:
+ *   src_id - SCEWL ID of the sender
+ *
+ * Returns:
+ *   pointer to the precomputed key
+ */
+const hmac_sha256_key_t *auth_sender_key(scewl_id_t src_id);
+
+
+/*
+ * auth_tag
+ *
+ * Computes the tag of a radio message. The tag covers the target, source and
+ * length from the SCEWL header, the security header and the body
+ *
+ * Args:
+ *   key - pointer to the sender's precomputed key
+ *   hdr - pointer to the SCEWL header of the message
+ *   sec - pointer to the security header of the message
+ *   body - pointer to the body of the message
+ *   len - length of the body
+ *   tag - buffer of AUTH_TAG_SZ bytes to write the tag to
+ */
+void auth_tag(const hmac_sha256_key_t *key, const scewl_hdr_t *hdr,
+              const void *sec, const void *body, uint16_t len, uint8_t *tag);
+
+
+/*
+ * auth_sign
+ *
+ * Computes the tag of a radio message sent by this device
+ *
+ * Args:
+ *   see auth_tag
+ */
+void auth_sign(const scewl_hdr_t *hdr, const void *sec, const void *body,
+               uint16_t len, uint8_t *tag);
+
+
+/*
+ * auth_verify
+ *
+ * Checks the tag of a radio message in constant time
+ *
+ * Args:
+ *   hdr - pointer to the SCEWL header of the message
+ *   data - pointer to the security header, body and tag as received
+ *   len - length of the body
+ *
+ * Returns:
+ *   1 if the tag is valid, 0 otherwise
+ */
+int auth_verify(const scewl_hdr_t *hdr, const char *data, uint16_t len);
+
+#endif // AUTH_H
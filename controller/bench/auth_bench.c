@@ -0,0 +1,89 @@
+/*
+ * 2021 Collegiate eCTF
+ * Verified-sender cache benchmark
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "bench.h"
+#include "auth.h"
+#include "peer.h"
+
+#define N_FRAMES  64
+#define N_SENDERS 8
+#define BODY_SZ   40  // about the size of a brdcst_msg_t from the SEDs
+
+// a broadcast as it sits in the controller's buffer after read_msg
+typedef struct frame_t {
+  scewl_hdr_t hdr;
+  char data[sizeof(scewl_sec_hdr_t) + BODY_SZ + AUTH_TAG_SZ];
+} frame_t;
+
+static frame_t frames[N_FRAMES];
+
+
+// build signed broadcasts from a handful of senders
+static void make_frames(void) {
+  scewl_sec_hdr_t sec;
+  frame_t *f;
+
+  for (int i = 0; i < N_FRAMES; i++) {
+    f = &frames[i];
+    f->hdr.src_id = SCEWL_FAA_ID + 1 + i % N_SENDERS;
+    f->hdr.tgt_id = SCEWL_BRDCST_ID;
+    f->hdr.len = sizeof(f->data);
+    sec.epoch = 1;
+    sec.seq = 1 + i;
+    memcpy(f->data, &sec, sizeof(sec));
+    memset(f->data + sizeof(sec), 'A' + i, BODY_SZ);
+    auth_tag(auth_sender_key(f->hdr.src_id), &f->hdr, f->data,
+             f->data + sizeof(sec), BODY_SZ, (uint8_t *)f->data + sizeof(sec) + BODY_SZ);
+  }
+}
+
+
+// run every frame through the replay check and MAC check like the controller
+static void run(char *name, int flush_each) {
+  scewl_sec_hdr_t sec;
+  uint32_t start, end, accepted = 0, per_frame;
+
+  peer_reset();
+  auth_flush();
+
+  start = bench_cycles();
+  for (int i = 0; i < N_FRAMES; i++) {
+    // without the cache every broadcast pays for the sender's credentials
+    if (flush_each) {
+      auth_flush();
+    }
+
+    memcpy(&sec, frames[i].data, sizeof(sec));
+    if (peer_check(frames[i].hdr.src_id, sec.epoch, sec.seq) &&
+        auth_verify(&frames[i].hdr, frames[i].data, BODY_SZ) &&
+        peer_record(frames[i].hdr.src_id, sec.epoch, sec.seq)) {
+      accepted++;
+    }
+  }
+  end = bench_cycles();
+
+  per_frame = (end - start) / N_FRAMES;
+  bench_report(name, per_frame, "cycles/frame");
+  bench_report(name, 1000000 / (per_frame ? per_frame : 1), "frames/Mcycle");
+  bench_report(name, accepted, "accepted");
+}
+
+
+int main() {
+  bench_init();
+  auth_init();
+  make_frames();
+
+  run("brdcst uncached", 1);
+  run("brdcst cached", 0);
+
+  return 0;
+}
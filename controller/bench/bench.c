@@ -0,0 +1,47 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller benchmark support
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "bench.h"
+#include "clock.h"
+
+#include <string.h>
+
+
+void bench_init(void) {
+  intf_init(BENCH_INTF);
+
+  // restart the cycle counter
+  clock_systick(0);
+}
+
+
+uint32_t bench_cycles(void) {
+  return clock_cycles();
+}
+
+
+void bench_report(char *name, uint32_t value, char *unit) {
+  char num[10];
+  int i = sizeof(num);
+
+  // format value right to left
+  do {
+    num[--i] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  intf_write(BENCH_INTF, name, strlen(name));
+  intf_write(BENCH_INTF, ": ", 2);
+  intf_write(BENCH_INTF, num + i, sizeof(num) - i);
+  intf_write(BENCH_INTF, " ", 1);
+  intf_write(BENCH_INTF, unit, strlen(unit));
+  intf_write(BENCH_INTF, "\n", 1);
+}
@@ -0,0 +1,54 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller benchmark support header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "interface.h"
+
+#include <stdint.h>
+
+// interface benchmark results are printed on
+#define BENCH_INTF CPU_INTF
+
+
+/*
+ * bench_init
+ *
+ * Initializes the report interface and starts the cycle counter
+ */
+void bench_init(void);
+
+
+/*
+ * bench_cycles
+ *
+ * Reads the free-running cycle counter
+ *
+ * Returns:
+ *   number of core clock cycles since bench_init, modulo 2^32
+ */
+uint32_t bench_cycles(void);
+
+
+/*
+ * bench_report
+ *
+ * Prints one result line of the form "name: value unit"
+ *
+ * Args:
+ *   name - name of the measurement
+ *   value - measured value
+ *   unit - unit of the value
+ */
+void bench_report(char *name, uint32_t value, char *unit);
+
+#endif // BENCH_H
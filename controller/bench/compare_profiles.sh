@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# 2021 Collegiate eCTF
+# Debug vs. release cycle count comparison
+#
+# (c) 2021 The MITRE Corporation
+#
+# This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+# This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+# and may not meet MITRE standards for quality. Use this code at your own risk!
+
+# Usage: bench/compare_profiles.sh [bench] [make args...]
+#
+# Builds a benchmark image in the debug and release profiles, runs both under
+# QEMU with a deterministic instruction count and prints their cycle counts
+# side by side. Fails if the release build needs more cycles for any result.
+# Run from controller/; leaves the release build in gcc/
+
+set -e
+
+BENCH=${1:-msg_bench}
+shift || true
+OUT=`mktemp -d`
+trap "rm -rf $OUT" EXIT
+
+# run an image until it returns and crashes QEMU on purpose
+run() {
+    timeout 300 qemu-system-arm -M lm3s6965evb -nographic -monitor none \
+        -icount shift=0 -serial stdio -kernel gcc/${BENCH}.bin 2>/dev/null || true
+}
+
+for profile in debug release; do
+    make clean > /dev/null
+    if [ $profile = release ]; then
+        make RELEASE=1 "$@" bench > /dev/null
+    else
+        make "$@" bench > /dev/null
+    fi
+    run | grep "cycles" > $OUT/$profile
+done
+
+# lines look like "name: value unit"
+paste -d '\n' $OUT/debug $OUT/release | awk -F': ' '
+    NR % 2 { name = $1; split($2, d, " "); next }
+    {
+        split($2, r, " ")
+        printf "%-28s %12d %12d  %5.2fx %s\n", name, d[1], r[1], d[1] / (r[1] ? r[1] : 1), d[2]
+        if (r[1] > d[1]) slower = 1
+    }
+    END { exit slower }' || { echo "release profile is slower than debug"; exit 1; }
@@ -0,0 +1,54 @@
+#!/bin/bash
+
+# 2021 Collegiate eCTF
+# Idle controller host CPU measurement
+#
+# (c) 2021 The MITRE Corporation
+#
+# This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+# This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+# and may not meet MITRE standards for quality. Use this code at your own risk!
+
+# Usage: bench/idle_cpu.sh [image] [instances] [seconds]
+#
+# Boots several controllers with nothing attached to their UARTs and reports
+# how much host CPU each one uses while it has no traffic
+
+set -e
+
+IMAGE=${1:-gcc/controller.bin}
+COUNT=${2:-4}
+SECONDS_IDLE=${3:-10}
+TICKS=`getconf CLK_TCK`
+PIDS=
+
+# host CPU ticks used so far by a process (user + system)
+cpu_ticks() {
+    awk '{ print $14 + $15 }' /proc/$1/stat
+}
+
+for i in `seq $COUNT`; do
+    qemu-system-arm -M lm3s6965evb -nographic -monitor none \
+        -serial null -serial null -serial null \
+        -kernel $IMAGE &
+    PIDS="$PIDS $!"
+done
+trap "kill $PIDS 2>/dev/null" EXIT
+
+# let them boot before sampling
+sleep 1
+
+START=0
+for pid in $PIDS; do
+    START=$((START + `cpu_ticks $pid`))
+done
+
+sleep $SECONDS_IDLE
+
+END=0
+for pid in $PIDS; do
+    END=$((END + `cpu_ticks $pid`))
+done
+
+echo "$COUNT idle controllers over ${SECONDS_IDLE}s:" \
+    "$(( (END - START) * 100 / (TICKS * SECONDS_IDLE * COUNT) ))% of a host core each"
@@ -0,0 +1,73 @@
+/*
+ * 2021 Collegiate eCTF
+ * Fixed message workload benchmark
+ *
+ * Runs the same mix of messages through signing and the replay and tag checks
+ * on every build, so bench/compare_profiles.sh can compare the cycle
+ * counts of the debug and release profiles
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "bench.h"
+#include "auth.h"
+#include "peer.h"
+#include "stack.h"
+
+#define N_MSGS    256
+#define N_SENDERS 4
+#define MAX_BODY  256
+
+static char frame[sizeof(scewl_sec_hdr_t) + MAX_BODY + AUTH_TAG_SZ];
+static uint32_t delivered, delivered_bytes;
+
+
+int main() {
+  scewl_hdr_t hdr;
+  scewl_sec_hdr_t sec;
+  uint16_t len;
+  uint32_t start, end;
+
+  bench_init();
+  auth_init();
+  peer_reset();
+
+  start = bench_cycles();
+  for (int i = 0; i < N_MSGS; i++) {
+    // body sizes from 16 to 256 bytes in a fixed order
+    len = 16 + (i * 37) % (MAX_BODY - 15);
+
+    hdr.src_id = SCEWL_FAA_ID + 1 + i % N_SENDERS;
+    hdr.tgt_id = i % 3 ? SCEWL_BRDCST_ID : SCEWL_ID;
+    hdr.len = sizeof(sec) + len + AUTH_TAG_SZ;
+    sec.epoch = 1;
+    sec.seq = 1 + i;
+
+    // sign as the sender would
+    memcpy(frame, &sec, sizeof(sec));
+    memset(frame + sizeof(sec), i, len);
+    auth_tag(auth_sender_key(hdr.src_id), &hdr, frame, frame + sizeof(sec), len,
+             (uint8_t *)frame + sizeof(sec) + len);
+
+    // receive as the controller would
+    if (peer_check(hdr.src_id, sec.epoch, sec.seq) &&
+        auth_verify(&hdr, frame, len) &&
+        peer_record(hdr.src_id, sec.epoch, sec.seq)) {
+      delivered++;
+      delivered_bytes += len;
+    }
+  }
+  end = bench_cycles();
+
+  bench_report("workload", end - start, "cycles");
+  bench_report("workload", (end - start) / N_MSGS, "cycles/msg");
+  bench_report("workload", delivered, "delivered");
+  bench_report("workload", delivered_bytes, "bytes");
+  bench_report("workload", stack_used(), "stack bytes");
+
+  return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * 2021 Collegiate eCTF
+ * Replay window benchmark
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "bench.h"
+#include "peer.h"
+
+#define N_FRAMES 4096
+#define N_PEERS  8
+
+
+// replay check and record for a frame taken as authentic
+static int peer_accept(scewl_id_t src_id, const scewl_sec_hdr_t *sec) {
+  return peer_check(src_id, sec->epoch, sec->seq) &&
+         peer_record(src_id, sec->epoch, sec->seq);
+}
+
+
+// push N_FRAMES frames through the replay check, returning how many were accepted
+static uint32_t run(char *name, uint32_t first, uint32_t swap) {
+  scewl_sec_hdr_t sec;
+  uint32_t start, end, accepted = 0;
+
+  sec.epoch = 1;
+
+  start = bench_cycles();
+  for (uint32_t i = 0; i < N_FRAMES; i++) {
+    // optionally swap each pair of frames from a peer to model reordering
+    sec.seq = first + (swap ? i ^ 1 : i);
+    accepted += peer_accept(SCEWL_FAA_ID + 1 + (i / 2) % N_PEERS, &sec);
+  }
+  end = bench_cycles();
+
+  bench_report(name, (end - start) / N_FRAMES, "cycles/frame");
+  return accepted;
+}
+
+
+int main() {
+  bench_init();
+  peer_reset();
+
+  bench_report("in order accepted", run("in order", 1, 0), "frames");
+  bench_report("reordered accepted", run("reordered", 1 + N_FRAMES, 1), "frames");
+  bench_report("replayed accepted", run("replayed", 1, 0), "frames");
+
+  return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * 2021 Collegiate eCTF
+ * Cooperative scheduler overhead benchmark
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "bench.h"
+#include "sched.h"
+
+#define N_SWITCHES 3000
+#define N_YIELDERS 3
+
+enum {
+  SIG_PING = SCHED_EV_USER,
+  SIG_PONG = SCHED_EV_USER << 1,
+};
+
+// a task with its own loop counter, since locals do not survive a yield
+typedef struct count_task_t {
+  task_t task;
+  int i;
+} count_task_t;
+
+static count_task_t yielders[N_YIELDERS];
+static count_task_t ping, pong;
+static volatile int calls;
+static int turn;
+
+
+// baseline: what the work itself costs without a scheduler
+static void plain_step(void) {
+  calls++;
+}
+
+
+static int run_yielder(task_t *t) {
+  count_task_t *c = (count_task_t *)t;
+
+  TASK_BEGIN(t);
+  for (c->i = 0; c->i < N_SWITCHES / N_YIELDERS; c->i++) {
+    calls++;
+    TASK_YIELD(t);
+  }
+  TASK_END(t);
+}
+
+
+// ping and pong hand the core back and forth through signals, the way the
+// controller's tasks wake each other
+static int run_ping(task_t *t) {
+  count_task_t *c = (count_task_t *)t;
+
+  TASK_BEGIN(t);
+  for (c->i = 0; c->i < N_SWITCHES / 2; c->i++) {
+    turn = 1;
+    sched_signal(SIG_PONG);
+    TASK_WAIT(t, SIG_PING, turn == 0);
+  }
+  TASK_END(t);
+}
+
+
+static int run_pong(task_t *t) {
+  count_task_t *c = (count_task_t *)t;
+
+  TASK_BEGIN(t);
+  for (c->i = 0; c->i < N_SWITCHES / 2; c->i++) {
+    TASK_WAIT(t, SIG_PONG, turn == 1);
+    turn = 0;
+    sched_signal(SIG_PING);
+  }
+  TASK_END(t);
+}
+
+
+int main(void) {
+  uint32_t start, end, base;
+  char report[SCHED_REPORT_SZ + 1];
+  int len;
+
+  bench_init();
+
+  start = bench_cycles();
+  for (int i = 0; i < N_SWITCHES; i++) {
+    plain_step();
+  }
+  end = bench_cycles();
+  base = end - start;
+  bench_report("direct call", base / N_SWITCHES, "cycles/step");
+
+  sched_init();
+  for (int i = 0; i < N_YIELDERS; i++) {
+    sched_add(&yielders[i].task, "yield", run_yielder);
+  }
+  start = bench_cycles();
+  sched_run();
+  end = bench_cycles();
+  bench_report("yield round robin", (end - start) / N_SWITCHES, "cycles/switch");
+
+  sched_init();
+  turn = 0;
+  sched_add(&ping.task, "ping", run_ping);
+  sched_add(&pong.task, "pong", run_pong);
+  start = bench_cycles();
+  sched_run();
+  end = bench_cycles();
+  bench_report("signal ping-pong", (end - start) / N_SWITCHES, "cycles/switch");
+
+  // per-task accounting of the last run
+  len = sched_report(report);
+  report[len] = '\n';
+  intf_write(BENCH_INTF, report, len + 1);
+
+  while (1);
+}
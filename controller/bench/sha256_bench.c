@@ -0,0 +1,79 @@
+/*
+ * 2021 Collegiate eCTF
+ * SHA-256 and HMAC-SHA-256 benchmark
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "bench.h"
+#include "sha256.h"
+
+#include <string.h>
+
+#define N_BLOCKS 64
+#define N_MACS   64
+
+// SHA-256("abc")
+static const uint8_t abc_digest[SHA256_DIGEST_SZ] = {
+  0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+  0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static uint8_t data[N_BLOCKS * SHA256_BLOCK_SZ];
+
+
+int main() {
+  sha256_ctx_t ctx;
+  hmac_sha256_ctx_t mac_ctx, keyed;
+  uint8_t digest[SHA256_DIGEST_SZ];
+  uint32_t start, end;
+
+  bench_init();
+
+  // make sure we are timing a correct implementation
+  sha256("abc", 3, digest);
+  bench_report("sha256 self test", !memcmp(digest, abc_digest, sizeof(digest)), "ok");
+
+  // bulk hashing, dominated by the compression function
+  sha256_init(&ctx);
+  start = bench_cycles();
+  sha256_update(&ctx, data, sizeof(data));
+  end = bench_cycles();
+  sha256_final(&ctx, digest);
+  bench_report("sha256 compress", (end - start) / N_BLOCKS, "cycles/block");
+
+  // the same data streamed in odd-sized pieces through the block buffer
+  sha256_init(&ctx);
+  start = bench_cycles();
+  for (size_t off = 0; off < sizeof(data); off += 13) {
+    sha256_update(&ctx, data + off, sizeof(data) - off < 13 ? sizeof(data) - off : 13);
+  }
+  end = bench_cycles();
+  sha256_final(&ctx, digest);
+  bench_report("sha256 streamed", (end - start) / N_BLOCKS, "cycles/block");
+
+  // MAC over one block with the key schedule computed every time
+  start = bench_cycles();
+  for (int i = 0; i < N_MACS; i++) {
+    hmac_sha256(abc_digest, sizeof(abc_digest), data, SHA256_BLOCK_SZ, digest);
+  }
+  end = bench_cycles();
+  bench_report("hmac-sha256 64B", (end - start) / N_MACS, "cycles/msg");
+
+  // and with the keyed context reused
+  hmac_sha256_init(&keyed, abc_digest, sizeof(abc_digest));
+  start = bench_cycles();
+  for (int i = 0; i < N_MACS; i++) {
+    mac_ctx = keyed;
+    hmac_sha256_update(&mac_ctx, data, SHA256_BLOCK_SZ);
+    hmac_sha256_final(&mac_ctx, digest);
+  }
+  end = bench_cycles();
+  bench_report("hmac-sha256 64B prekeyed", (end - start) / N_MACS, "cycles/msg");
+
+  return 0;
+}
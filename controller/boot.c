@@ -0,0 +1,69 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller boot timeline
+ *
+ * The first stamps are taken before memory is initialized, so the timeline
+ * lives in .noinit and is reset by the BOOT_RESET stamp instead. Times are
+ * kept in microseconds, converting each step at the clock that was running
+ * when it ended; the step across SystemInit is only approximate since the
+ * PLL takes over part way through it. Steps are timed on the 64-bit cycle
+ * count, so a long wait for the SSS is not cut short by the 32-bit one
+ * wrapping
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "boot.h"
+#include "clock.h"
+#include "fmt.h"
+
+#include <string.h>
+
+static const char *names[BOOT_EVENTS] = {
+  "reset", "data", "clock", "periph", "reg_sent", "reg_done",
+};
+
+// microseconds since reset of each event, and where the last stamp was taken
+static uint32_t times[BOOT_EVENTS] NOINIT;
+static uint64_t last_cycles NOINIT;
+static uint32_t last_us NOINIT;
+
+
+void boot_stamp(int event) {
+  uint64_t now = clock_cycles64();
+
+  if (event == BOOT_RESET) {
+    memset(times, 0, sizeof(times));
+    last_us = 0;
+  } else {
+    last_us += (now - last_cycles) * 1000000 / clock_hz();
+    times[event] = last_us;
+  }
+  last_cycles = now;
+}
+
+
+uint32_t boot_us(int event) {
+  return times[event];
+}
+
+
+int boot_report(char *out) {
+  int n = 0;
+
+  memcpy(out, "boot us:", 8);
+  n += 8;
+  for (int i = 0; i < BOOT_EVENTS; i++) {
+    out[n++] = ' ';
+    memcpy(out + n, names[i], strlen(names[i]));
+    n += strlen(names[i]);
+    out[n++] = ' ';
+    n += fmt_num(out + n, times[i]);
+  }
+
+  return n;
+}
@@ -0,0 +1,73 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller boot timeline header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "interface.h"
+
+#include <stdint.h>
+
+// points on the way from reset to a registered SED
+enum boot_event {
+  BOOT_RESET,     // Reset_Handler entered
+  BOOT_DATA,      // .data copied and .bss zeroed
+  BOOT_CLOCK,     // SystemInit done
+  BOOT_PERIPH,    // interfaces initialized
+  BOOT_REG_SENT,  // registration sent to the SSS
+  BOOT_REG_DONE,  // registration accepted
+  BOOT_EVENTS
+};
+
+// longest text boot_report writes
+#define BOOT_REPORT_SZ 128
+
+
+/*
+ * boot_stamp
+ *
+ * Records the time of an event. BOOT_RESET starts a new timeline and must be
+ * stamped right after SysTick is started in Reset_Handler. Stamping an event
+ * again overwrites its time
+ *
+ * Args:
+ *   event - the boot_event that just happened
+ */
+void boot_stamp(int event);
+
+
+/*
+ * boot_us
+ *
+ * Args:
+ *   event - a boot_event
+ *
+ * Returns:
+ *   microseconds from reset to the event, or 0 if it has not happened yet
+ */
+uint32_t boot_us(int event);
+
+
+/*
+ * boot_report
+ *
+ * Formats the timeline as one line of text, e.g.
+ * "boot us: reset 0 data 12 clock 40 periph 95 reg_sent 1003021 reg_done 1004100"
+ *
+ * Args:
+ *   out - buffer of at least BOOT_REPORT_SZ bytes
+ *
+ * Returns:
+ *   length of the text, which is not NUL terminated
+ */
+int boot_report(char *out);
+
+#endif // BOOT_H
@@ -0,0 +1,93 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller clock
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "clock.h"
+
+// SysTick reload value, number of reloads so far and cycles counted before
+// the last period change. Set up before memory is initialized, so they must
+// not be zeroed with .bss
+static uint32_t reload NOINIT;
+static volatile uint32_t reloads NOINIT;
+static uint64_t base NOINIT;
+
+
+void SysTick_Handler(void) {
+  reloads++;
+}
+
+
+uint32_t clock_hz(void) {
+  return SystemFrequency;
+}
+
+
+uint32_t clock_ticks(uint32_t us) {
+  return (uint32_t)((uint64_t)SystemFrequency * us / 1000000);
+}
+
+
+static void systick_start(uint32_t period_us) {
+  reload = period_us ? clock_ticks(period_us) - 1 : SysTick_LOAD_RELOAD_Msk;
+
+  // clamp to the 24-bit counter
+  if (reload > SysTick_LOAD_RELOAD_Msk) {
+    reload = SysTick_LOAD_RELOAD_Msk;
+  }
+
+  SysTick->CTRL = 0;
+  SysTick->LOAD = reload;
+  SysTick->VAL  = 0;
+  reloads = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk |
+                  SysTick_CTRL_TICKINT_Msk;
+}
+
+
+void clock_systick(uint32_t period_us) {
+  base = 0;
+  systick_start(period_us);
+}
+
+
+void clock_period(uint32_t period_us) {
+  // the cycles lost between reading the counter and restarting it are not
+  // worth correcting for
+  __disable_irq();
+  base = clock_cycles64();
+  systick_start(period_us);
+  __enable_irq();
+}
+
+
+uint32_t clock_cycles(void) {
+  uint32_t n, val;
+
+  // retry if the counter reloaded while reading
+  do {
+    n = reloads;
+    val = SysTick->VAL;
+  } while (n != reloads);
+
+  // SysTick counts down
+  return (uint32_t)base + n * (reload + 1) + (reload - val);
+}
+
+
+uint64_t clock_cycles64(void) {
+  uint32_t n, val;
+
+  do {
+    n = reloads;
+    val = SysTick->VAL;
+  } while (n != reloads);
+
+  return base + (uint64_t)n * (reload + 1) + (reload - val);
+}
@@ -0,0 +1,91 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller clock header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "interface.h"
+
+#include <stdint.h>
+
+
+/*
+ * clock_hz
+ *
+ * Returns:
+ *   the core clock frequency set up by SystemInit, in Hz
+ */
+uint32_t clock_hz(void);
+
+
+/*
+ * clock_ticks
+ *
+ * Converts a time to core clock ticks, for SysTick and timer reload values
+ *
+ * Args:
+ *   us - time in microseconds
+ *
+ * Returns:
+ *   number of core clock ticks, rounded down
+ */
+uint32_t clock_ticks(uint32_t us);
+
+
+/*
+ * clock_systick
+ *
+ * Starts SysTick from the core clock, counting reloads in SysTick_Handler.
+ * Reset_Handler starts it with the longest period before memory is
+ * initialized, so clock_cycles counts from reset
+ *
+ * Args:
+ *   period_us - time between reloads in microseconds, or 0 for the longest
+ *     period SysTick supports
+ */
+void clock_systick(uint32_t period_us);
+
+
+/*
+ * clock_period
+ *
+ * Changes the time between SysTick reloads without restarting clock_cycles
+ *
+ * Args:
+ *   period_us - time between reloads in microseconds, or 0 for the longest
+ *     period SysTick supports
+ */
+void clock_period(uint32_t period_us);
+
+
+/*
+ * clock_cycles
+ *
+ * Reads the cycle counter kept by SysTick
+ *
+ * Returns:
+ *   number of core clock cycles since clock_systick, modulo 2^32
+ */
+uint32_t clock_cycles(void);
+
+
+/*
+ * clock_cycles64
+ *
+ * Reads the cycle counter kept by SysTick without wrapping, for spans that
+ * can outlast the 32-bit count (a minute and a half at 50 MHz)
+ *
+ * Returns:
+ *   number of core clock cycles since clock_systick
+ */
+uint64_t clock_cycles64(void);
+
+#endif // CLOCK_H
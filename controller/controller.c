@@ -11,6 +11,16 @@
  */
 
 #include "controller.h"
+#include "peer.h"
+#include "auth.h"
+#include "clock.h"
+#include "boot.h"
+#include "persist.h"
+#include "sched.h"
+#include "trace.h"
+#ifdef BENCH
+#include "selfbench.h"
+#endif
 
 // this will run if EXAMPLE_AES is defined in the Makefile (see line 54)
 #ifdef EXAMPLE_AES
@@ -25,14 +35,42 @@ char int2char(uint8_t i) {
 #define send_str(M) send_msg(RAD_INTF, SCEWL_ID, SCEWL_FAA_ID, strlen(M), M)
 #define BLOCK_SIZE 16
 
-// message buffer
-char buf[SCEWL_MAX_DATA_SZ];
+// message buffer, large enough for a full CPU message plus the security header
+// and tag. Every read fills it first, so it is left out of .bss zeroing
+char buf[sizeof(scewl_sec_hdr_t) + SCEWL_MAX_DATA_SZ + AUTH_TAG_SZ] NOINIT;
 
 int registered = 0;
 
+// set while registered from the warm-start log until the SSS confirms it
+int warm = 0;
+
+// outgoing security header state
+uint32_t tx_epoch = 0;
+uint32_t tx_seq = 0;
+
+#ifdef SCHED_STATS
+// time between scheduler reports to the FAA transceiver
+#define SCHED_STATS_US 10000000
+#endif
+
+// registration request handed from the CPU task to the SSS task
+uint16_t reg_op;
+int reg_pending = 0;
+
+// the controller's work, split into tasks (see sched.h)
+task_t cpu_task, sss_task, rad_task;
+#ifdef SCHED_STATS
+task_t stats_task;
+#endif
+
+// signals between tasks
+enum {
+  SIG_REG = SCHED_EV_USER,  // registration requested or finished
+};
+
 
-int read_msg(intf_t *intf, char *data, scewl_id_t *src_id, scewl_id_t *tgt_id,
-             size_t n, int blocking) {
+HOT int read_msg(intf_t *intf, char *data, scewl_id_t *src_id, scewl_id_t *tgt_id,
+                 size_t n, int blocking) {
   scewl_hdr_t hdr;
   int read, max;
 
@@ -64,6 +102,8 @@ int read_msg(intf_t *intf, char *data, scewl_id_t *src_id, scewl_id_t *tgt_id,
     return SCEWL_NO_MSG;
   }
 
+  TRACE_EVENT(TRACE_HDR, TRACE_INTF(intf), hdr.len);
+
   // unpack header
   *src_id = hdr.src_id;
   *tgt_id = hdr.tgt_id;
@@ -86,7 +126,7 @@ int read_msg(intf_t *intf, char *data, scewl_id_t *src_id, scewl_id_t *tgt_id,
 }
 
 
-int send_msg(intf_t *intf, scewl_id_t src_id, scewl_id_t tgt_id, uint16_t len, char *data) {
+HOT int send_msg(intf_t *intf, scewl_id_t src_id, scewl_id_t tgt_id, uint16_t len, char *data) {
   scewl_hdr_t hdr;
 
   // pack header
@@ -96,33 +136,118 @@ int send_msg(intf_t *intf, scewl_id_t src_id, scewl_id_t tgt_id, uint16_t len, c
   hdr.tgt_id = tgt_id;
   hdr.len    = len;
 
+  TRACE_EVENT(TRACE_TX_QUEUED, TRACE_INTF(intf), len);
+
   // send header
   intf_write(intf, (char *)&hdr, sizeof(scewl_hdr_t));
 
   // send body
   intf_write(intf, data, len);
 
+  TRACE_EVENT(TRACE_TX_DONE, TRACE_INTF(intf), len);
+
   return SCEWL_OK;
 }
 
 
+HOT int send_sec_msg(scewl_id_t tgt_id, uint16_t len, char *data) {
+  scewl_hdr_t hdr;
+  scewl_sec_hdr_t sec;
+  uint8_t tag[AUTH_TAG_SZ];
+
+  // pack headers
+  hdr.magicS  = 'S';
+  hdr.magicC  = 'C';
+  hdr.src_id = SCEWL_ID;
+  hdr.tgt_id = tgt_id;
+  hdr.len    = sizeof(scewl_sec_hdr_t) + len + AUTH_TAG_SZ;
+  sec.epoch  = tx_epoch;
+  sec.seq    = ++tx_seq;
+
+  TRACE_EVENT(TRACE_CRYPTO_START, TRACE_RAD, len);
+  auth_sign(&hdr, &sec, data, len, tag);
+  TRACE_EVENT(TRACE_CRYPTO_END, TRACE_RAD, len);
+
+  TRACE_EVENT(TRACE_TX_QUEUED, TRACE_RAD, hdr.len);
+
+  // send headers
+  intf_write(RAD_INTF, (char *)&hdr, sizeof(scewl_hdr_t));
+  intf_write(RAD_INTF, (char *)&sec, sizeof(scewl_sec_hdr_t));
+
+  // send body and tag
+  intf_write(RAD_INTF, data, len);
+  intf_write(RAD_INTF, (char *)tag, AUTH_TAG_SZ);
+
+  TRACE_EVENT(TRACE_TX_DONE, TRACE_RAD, hdr.len);
+
+  return SCEWL_OK;
+}
+
+
+// authenticate a radio message and strip its security header and tag,
+// returning the body length or SCEWL_ERR if the message must be dropped
+HOT static int open_sec_msg(char *data, scewl_id_t src_id, scewl_id_t tgt_id, uint16_t len) {
+  scewl_hdr_t hdr;
+  scewl_sec_hdr_t sec;
+
+  if (len < sizeof(scewl_sec_hdr_t) + AUTH_TAG_SZ) {
+    return SCEWL_ERR;
+  }
+
+  // copy out in case the body is not word aligned
+  memcpy(&sec, data, sizeof(scewl_sec_hdr_t));
+
+  // cheap replay check first, against peers already heard from
+  if (!peer_check(src_id, sec.epoch, sec.seq)) {
+    return SCEWL_ERR;
+  }
+
+  // only authentic messages may move the window
+  hdr.src_id = src_id;
+  hdr.tgt_id = tgt_id;
+  hdr.len    = len;
+  len -= sizeof(scewl_sec_hdr_t) + AUTH_TAG_SZ;
+  TRACE_EVENT(TRACE_CRYPTO_START, TRACE_RAD, len);
+  if (!auth_verify(&hdr, data, len)) {
+    TRACE_EVENT(TRACE_CRYPTO_END, TRACE_RAD, len);
+    return SCEWL_ERR;
+  }
+  TRACE_EVENT(TRACE_CRYPTO_END, TRACE_RAD, len);
+  if (!peer_record(src_id, sec.epoch, sec.seq)) {
+    return SCEWL_ERR;
+  }
+
+  return len;
+}
+
+
 int handle_scewl_recv(char* data, scewl_id_t src_id, uint16_t len) {
-  return send_msg(CPU_INTF, src_id, SCEWL_ID, len, data);
+  int body_len = open_sec_msg(data, src_id, SCEWL_ID, len);
+
+  if (body_len == SCEWL_ERR) {
+    return SCEWL_ERR;
+  }
+  return send_msg(CPU_INTF, src_id, SCEWL_ID, body_len, data + sizeof(scewl_sec_hdr_t));
 }
 
 
 int handle_scewl_send(char* data, scewl_id_t tgt_id, uint16_t len) {
-  return send_msg(RAD_INTF, SCEWL_ID, tgt_id, len, data);
+  return send_sec_msg(tgt_id, len, data);
 }
 
 
 int handle_brdcst_recv(char* data, scewl_id_t src_id, uint16_t len) {
-  return send_msg(CPU_INTF, src_id, SCEWL_BRDCST_ID, len, data);
+  int body_len = open_sec_msg(data, src_id, SCEWL_BRDCST_ID, len);
+
+  if (body_len == SCEWL_ERR) {
+    return SCEWL_ERR;
+  }
+  return send_msg(CPU_INTF, src_id, SCEWL_BRDCST_ID, body_len, data + sizeof(scewl_sec_hdr_t));
 }
 
 
 int handle_brdcst_send(char *data, uint16_t len) {
-  return send_msg(RAD_INTF, SCEWL_ID, SCEWL_BRDCST_ID, len, data);
+  return send_sec_msg(SCEWL_BRDCST_ID, len, data);
 }   
 
 
@@ -136,30 +261,71 @@ int handle_faa_send(char* data, uint16_t len) {
 }
 
 
+void save_state(void) {
+  persist_state_t st;
+
+  st.registered = registered;
+  st.epoch = tx_epoch;
+  persist_save(&st);
+}
+
+
 void handle_registration(char* msg) {
   scewl_sss_msg_t *sss_msg = (scewl_sss_msg_t *)msg;
-  if (sss_msg->op == SCEWL_SSS_REG && sss_register()) {
+
+  // the SSS task carries it out
+  reg_op = sss_msg->op;
+  reg_pending = 1;
+  sched_signal(SIG_REG);
+}
+
+
+void registration_done(uint16_t op) {
+  if (op == SCEWL_SSS_REG && warm) {
+    // the SSS confirmed the registration resumed at boot, which the radio has
+    // been using since, so keep the peers heard from meanwhile
+    warm = 0;
+  } else if (op == SCEWL_SSS_REG) {
     registered = 1;
-  } else if (sss_msg->op == SCEWL_SSS_DEREG && sss_deregister()) {
+    save_state();
+    auth_flush();
+    boot_stamp(BOOT_REG_DONE);
+#ifdef BOOT_TIMELINE
+    send_msg(RAD_INTF, SCEWL_ID, SCEWL_FAA_ID, boot_report(buf), buf);
+#endif
+  } else {
     registered = 0;
+    warm = 0;
+    save_state();
+    auth_flush();
   }
 }
 
 
-int sss_register() {
+int sss_request(uint16_t op) {
   scewl_sss_msg_t msg;
-  scewl_id_t src_id, tgt_id;
-  int status, len;
+  int status;
 
   // fill registration message
   msg.dev_id = SCEWL_ID;
-  msg.op = SCEWL_SSS_REG;
-  
+  msg.op = op;
+
   // send registration
   status = send_msg(SSS_INTF, SCEWL_ID, SCEWL_SSS_ID, sizeof(msg), (char *)&msg);
   if (status == SCEWL_ERR) {
-    return 0;
+    return SCEWL_ERR;
+  }
+  if (op == SCEWL_SSS_REG) {
+    boot_stamp(BOOT_REG_SENT);
   }
+  return SCEWL_OK;
+}
+
+
+int sss_response(uint16_t op) {
+  scewl_sss_msg_t msg;
+  scewl_id_t src_id, tgt_id;
+  int status, len;
 
   // receive response
   len = read_msg(SSS_INTF, (char *)&msg, &src_id, &tgt_id, sizeof(scewl_sss_msg_t), 1);
@@ -170,48 +336,145 @@ int sss_register() {
     return 0;
   }
 
-  // op should be REG on success
-  return msg.op == SCEWL_SSS_REG;
+  // op should be echoed on success. A registration resumed from the
+  // warm-start log is also confirmed if the SSS still holds it
+  return msg.op == op ||
+         (warm && op == SCEWL_SSS_REG && msg.op == (uint16_t)SCEWL_SSS_ALREADY);
 }
 
 
-int sss_deregister() {
-  scewl_sss_msg_t msg;
-  scewl_id_t src_id, tgt_id;
-  int status, len;
+// read messages from the CPU and send them on
+static int run_cpu(task_t *t) {
+  static int len;
+  static scewl_id_t src_id, tgt_id;
 
-  // fill registration message
-  msg.dev_id = SCEWL_ID;
-  msg.op = SCEWL_SSS_DEREG;
-  
-  // send registration
-  status = send_msg(SSS_INTF, SCEWL_ID, SCEWL_SSS_ID, sizeof(msg), (char *)&msg);
-  if (status == SCEWL_ERR) {
-    return 0;
+  TASK_BEGIN(t);
+  while (1) {
+    TASK_WAIT(t, SCHED_EV_CPU, intf_avail(CPU_INTF));
+    len = read_msg(CPU_INTF, buf, &src_id, &tgt_id, SCEWL_MAX_DATA_SZ, 1);
+
+    if (tgt_id == SCEWL_SSS_ID) {
+      TRACE_EVENT(TRACE_ROUTE, TRACE_SSS, len);
+      handle_registration(buf);
+
+      // leave the next CPU message unread until the SSS has answered
+      TASK_WAIT(t, SIG_REG, !reg_pending);
+    } else if (!registered) {
+      // only registration is allowed before registering
+      TRACE_EVENT(TRACE_ROUTE, TRACE_DROP, len);
+    } else if (tgt_id == SCEWL_BRDCST_ID) {
+      TRACE_EVENT(TRACE_ROUTE, TRACE_RAD, len);
+      handle_brdcst_send(buf, len);
+    } else if (tgt_id == SCEWL_FAA_ID) {
+      TRACE_EVENT(TRACE_ROUTE, TRACE_RAD, len);
+      handle_faa_send(buf, len);
+    } else {
+      TRACE_EVENT(TRACE_ROUTE, TRACE_RAD, len);
+      handle_scewl_send(buf, tgt_id, len);
+    }
   }
+  TASK_END(t);
+}
 
-  // receive response
-  len = read_msg(SSS_INTF, (char *)&msg, &src_id, &tgt_id, sizeof(scewl_sss_msg_t), 1);
 
-  // notify CPU of response
-  status = send_msg(CPU_INTF, src_id, tgt_id, len, (char *)&msg);
-  if (status == SCEWL_ERR) {
-    return 0;
+// carry out (de)registration requests, serving the radio while the SSS
+// answers
+static int run_sss(task_t *t) {
+  TASK_BEGIN(t);
+  while (1) {
+    TASK_WAIT(t, SIG_REG, reg_pending);
+
+    if ((reg_op == SCEWL_SSS_REG || reg_op == SCEWL_SSS_DEREG) &&
+        sss_request(reg_op) == SCEWL_OK) {
+      TASK_WAIT(t, SCHED_EV_SSS, intf_avail(SSS_INTF));
+      if (sss_response(reg_op)) {
+        registration_done(reg_op);
+      } else if (warm) {
+        // the SSS no longer knows this SED, so start over unregistered
+        registration_done(SCEWL_SSS_DEREG);
+      }
+    }
+
+    reg_pending = 0;
+    sched_signal(SIG_REG);
+  }
+  TASK_END(t);
+}
+
+
+// read radio messages while registered
+static int run_rad(task_t *t) {
+  static int len;
+  static scewl_id_t src_id, tgt_id;
+
+  TASK_BEGIN(t);
+  while (1) {
+    // unregistered controllers leave the radio unread
+    TASK_WAIT(t, SIG_REG, registered);
+    TASK_WAIT(t, SCHED_EV_RAD | SIG_REG, !registered || intf_avail(RAD_INTF));
+    if (!registered) {
+      continue;
+    }
+
+    len = read_msg(RAD_INTF, buf, &src_id, &tgt_id, sizeof(buf), 1);
+
+    if (src_id == SCEWL_ID) {
+      // ignore our own outgoing messages
+      TRACE_EVENT(TRACE_ROUTE, TRACE_DROP, len);
+#ifdef TRACE
+    } else if (src_id == SCEWL_FAA_ID && tgt_id == SCEWL_ID &&
+               len == sizeof(TRACE_CMD) - 1 && !memcmp(buf, TRACE_CMD, len)) {
+      // the FAA transceiver asks for the trace (see tools/trace_report.py)
+      TRACE_EVENT(TRACE_ROUTE, TRACE_RAD, len);
+      send_msg(RAD_INTF, SCEWL_ID, SCEWL_FAA_ID, sizeof(trace_log), (char *)&trace_log);
+#endif
+    } else if (src_id == SCEWL_FAA_ID && tgt_id == SCEWL_ID) {
+      // receive FAA message
+      TRACE_EVENT(TRACE_ROUTE, TRACE_CPU, len);
+      handle_faa_recv(buf, len);
+    } else if (tgt_id == SCEWL_BRDCST_ID) {
+      // receive broadcast message
+      TRACE_EVENT(TRACE_ROUTE, TRACE_CPU, len);
+      handle_brdcst_recv(buf, src_id, len);
+    } else if (tgt_id == SCEWL_ID) {
+      // receive unicast message
+      TRACE_EVENT(TRACE_ROUTE, TRACE_CPU, len);
+      handle_scewl_recv(buf, src_id, len);
+    } else {
+      TRACE_EVENT(TRACE_ROUTE, TRACE_DROP, len);
+    }
   }
+  TASK_END(t);
+}
+
 
-  // op should be DEREG on success
-  return msg.op == SCEWL_SSS_DEREG;
+#ifdef SCHED_STATS
+// send the scheduler's CPU time accounting to the FAA transceiver
+static int run_stats(task_t *t) {
+  TASK_BEGIN(t);
+  while (1) {
+    TASK_SLEEP(t, SCHED_STATS_US);
+    if (registered) {
+      send_msg(RAD_INTF, SCEWL_ID, SCEWL_FAA_ID, sched_report(buf), buf);
+    }
+  }
+  TASK_END(t);
 }
+#endif
+
 
 int main() {
-  int len;
-  scewl_hdr_t hdr;
-  uint16_t src_id, tgt_id;
+  persist_state_t st;
+
+#ifdef TRACE
+  trace_init();
+#endif
 
   // initialize interfaces
   intf_init(CPU_INTF);
   intf_init(SSS_INTF);
   intf_init(RAD_INTF);
+  boot_stamp(BOOT_PERIPH);
 
 #ifdef EXAMPLE_AES
   // example encryption using tiny-AES-c
@@ -234,56 +497,32 @@ int main() {
   // end example
 #endif
 
-  // serve forever
-  while (1) {
-    // register with SSS
-    read_msg(CPU_INTF, buf, &hdr.src_id, &hdr.tgt_id, sizeof(buf), 1);
-
-    if (hdr.tgt_id == SCEWL_SSS_ID) {
-      handle_registration(buf);
-    }
-
-    // server while registered
-    while (registered) {
-      memset(&hdr, 0, sizeof(hdr));
-
-      // handle outgoing message from CPU
-      if (intf_avail(CPU_INTF)) {
-        // Read message from CPU
-        len = read_msg(CPU_INTF, buf, &src_id, &tgt_id, sizeof(buf), 1);
-
-        if (tgt_id == SCEWL_BRDCST_ID) {
-          handle_brdcst_send(buf, len);
-        } else if (tgt_id == SCEWL_SSS_ID) {
-          handle_registration(buf);
-        } else if (tgt_id == SCEWL_FAA_ID) {
-          handle_faa_send(buf, len);
-        } else {
-          handle_scewl_send(buf, tgt_id, len);
-        }
+  // derive message authentication keys
+  auth_init();
 
-        continue;
-      }
+#ifdef BENCH
+  // report the benchmark suite to the FAA transceiver, then carry on as usual
+  selfbench_run(buf);
+#endif
 
-      // handle incoming radio message
-      if (intf_avail(RAD_INTF)) {
-        // Read message from antenna
-        len = read_msg(RAD_INTF, buf, &src_id, &tgt_id, sizeof(buf), 1);
-
-        if (src_id != SCEWL_ID) { // ignore our own outgoing messages
-          if (tgt_id == SCEWL_BRDCST_ID) {
-            // receive broadcast message
-            handle_brdcst_recv(buf, src_id, len);
-          } else if (tgt_id == SCEWL_ID) {
-            // receive unicast message
-            if (src_id == SCEWL_FAA_ID) {
-              handle_faa_recv(buf, len);
-            } else {
-              handle_scewl_recv(buf, src_id, len);
-            }
-          }
-        }
-      }
-    }
+  // resume from the warm-start log if it holds a record from this SED.
+  // Either way the boot epoch moves past every one recorded, so peers can
+  // tell frames from this boot apart from replays of earlier ones
+  if (persist_load(&st) && st.registered) {
+    registered = 1;
+    warm = 1;
+    boot_stamp(BOOT_REG_DONE);
   }
+  tx_epoch = st.epoch + 1;
+  save_state();
+
+  // serve forever
+  sched_init();
+  sched_add(&cpu_task, "cpu", run_cpu);
+  sched_add(&sss_task, "sss", run_sss);
+  sched_add(&rad_task, "rad", run_rad);
+#ifdef SCHED_STATS
+  sched_add(&stats_task, "stats", run_stats);
+#endif
+  sched_run();
 }
@@ -14,7 +14,6 @@
 #define CONTROLLER_H
 
 #include "interface.h"
-#include "lm3s/lm3s_cmsis.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -42,6 +41,12 @@ typedef struct scewl_hdr_t {
   /* data follows */
 } scewl_hdr_t;
 
+// security header carried at the start of SED-to-SED radio message bodies
+typedef struct scewl_sec_hdr_t {
+  uint32_t epoch;  // sender boot count, kept in its warm-start log
+  uint32_t seq;    // sender message counter, starts at 1 every epoch
+} scewl_sec_hdr_t;
+
 // registration message
 typedef struct scewl_sss_msg_t {
   scewl_id_t dev_id;
@@ -87,6 +92,19 @@ int read_msg(intf_t *intf, char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
  */
 int send_msg(intf_t *intf, scewl_id_t src_id, scewl_id_t tgt_id, uint16_t len, char *data);
 
+/*
+ * send_sec_msg
+ *
+ * Sends a message from this device over the antenna with the next security
+ * header placed in front of the body
+ *
+ * Args:
+ *   tgt_id - the id of the receiving device
+ *   len - the length of message
+ *   data - pointer to the message
+ */
+int send_sec_msg(scewl_id_t tgt_id, uint16_t len, char *data);
+
 /*
  * handle_scewl_recv
  * 
@@ -129,10 +147,17 @@ int handle_faa_recv(char* data, uint16_t len);
  */
 int handle_faa_send(char* data, uint16_t len);
 
+/*
+ * save_state
+ * 
+ * Records the registration status and boot epoch in the warm-start log
+ */
+void save_state(void);
+
 /*
  * handle_registration
  * 
- * Interprets a CPU registration message
+ * Interprets a CPU registration message, handing it to the SSS task
  * 
  * args:
  *   op - pointer to the operation message received by the CPU
@@ -140,18 +165,40 @@ int handle_faa_send(char* data, uint16_t len);
 void handle_registration(char* op);
 
 /*
- * sss_register
+ * registration_done
+ * 
+ * Updates the controller state after the SSS accepted a (de)registration.
+ * Registering after a warm start only confirms the registration resumed at
+ * boot
+ * 
+ * args:
+ *   op - SCEWL_SSS_REG or SCEWL_SSS_DEREG
+ */
+void registration_done(uint16_t op);
+
+/*
+ * sss_request
+ * 
+ * Sends a (de)registration request to the SSS
  * 
- * Performs a registration with the SSS
+ * args:
+ *   op - SCEWL_SSS_REG or SCEWL_SSS_DEREG
  */
-int sss_register();
+int sss_request(uint16_t op);
 
 /*
- * sss_deregister
+ * sss_response
+ * 
+ * Receives the SSS response to a request and passes it on to the CPU
+ * 
+ * args:
+ *   op - operation that was requested
  * 
- * Performs a deregistration with the SSS
+ * returns:
+ *   1 if the SSS carried the operation out or, after a warm start, still held
+ *   the registration, 0 otherwise
  */
-int sss_deregister();
+int sss_response(uint16_t op);
 
 
 #endif
@@ -0,0 +1,29 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller report formatting
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "fmt.h"
+
+
+int fmt_num(char *out, uint32_t value) {
+  char num[FMT_NUM_SZ];
+  int i = sizeof(num), n = 0;
+
+  // format right to left, then copy out the digits used
+  do {
+    num[--i] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  while (i < sizeof(num)) {
+    out[n++] = num[i++];
+  }
+  return n;
+}
@@ -0,0 +1,36 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller report formatting header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+// longest text fmt_num writes
+#define FMT_NUM_SZ 10
+
+
+/*
+ * fmt_num
+ *
+ * Writes a number in decimal, without a terminator, for the text reports
+ * sent to the FAA transceiver
+ *
+ * Args:
+ *   out - buffer of at least FMT_NUM_SZ bytes to write to
+ *   value - number to write
+ *
+ * Returns:
+ *   the number of bytes written
+ */
+int fmt_num(char *out, uint32_t value);
+
+#endif // FMT_H
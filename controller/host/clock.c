@@ -0,0 +1,75 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller hosted clock implementation
+ *
+ * Implements clock.h from the host's monotonic clock, counting in cycles of
+ * a HOST_HZ core so callers work unchanged
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "clock.h"
+
+#include <time.h>
+
+// longest SysTick period on the target, 2^24 cycles
+#define MAX_PERIOD_US ((uint32_t)((uint64_t)0x1000000 * 1000000 / HOST_HZ))
+
+// host time clock_cycles counts from, and the emulated SysTick period
+static uint64_t base_ns;
+static uint32_t period_us = MAX_PERIOD_US;
+
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+// the process starting stands in for reset, which starts the target's
+// SysTick before anything else runs
+__attribute__((constructor)) static void clock_reset(void) {
+  base_ns = now_ns();
+}
+
+
+uint32_t clock_hz(void) {
+  return HOST_HZ;
+}
+
+
+uint32_t clock_ticks(uint32_t us) {
+  return (uint32_t)((uint64_t)HOST_HZ * us / 1000000);
+}
+
+
+void clock_systick(uint32_t period) {
+  base_ns = now_ns();
+  clock_period(period);
+}
+
+
+void clock_period(uint32_t period) {
+  period_us = period && period < MAX_PERIOD_US ? period : MAX_PERIOD_US;
+}
+
+
+uint32_t clock_cycles(void) {
+  return clock_cycles64();
+}
+
+
+uint64_t clock_cycles64(void) {
+  return (now_ns() - base_ns) * (HOST_HZ / 1000000) / 1000;
+}
+
+
+int host_tick_ms(void) {
+  return period_us < 1000 ? 1 : period_us / 1000;
+}
@@ -0,0 +1,81 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller hosted flash
+ *
+ * Stands in for the flash holding the warm-start log, kept in the file
+ * flash_<SCEWL_ID>.bin under $FLASH_ROOT (the working directory if unset) so
+ * that it survives restarts like the target's. Erasing and writing behave as
+ * on the target: erasing sets a page to ones and writing can only clear bits
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "persist.h"
+#include "controller.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+uint8_t host_flash[PERSIST_PAGES * FLASH_PAGE_SZ] __attribute__((aligned(4)));
+
+// backing file, or -1 to keep the log in memory only
+static int fd = -1;
+static int ready;
+
+
+// write a range of the image back to the file
+static void flash_sync(uint32_t off, uint32_t len) {
+  if (fd >= 0 && pwrite(fd, host_flash + off, len, off) != len) {
+    perror("flash");
+  }
+}
+
+
+void flash_setup(void) {
+  const char *root = getenv("FLASH_ROOT");
+  char path[256];
+  ssize_t len;
+
+  if (ready) {
+    return;
+  }
+  ready = 1;
+
+  // whatever the file does not cover reads as erased
+  memset(host_flash, 0xff, sizeof(host_flash));
+  snprintf(path, sizeof(path), "%s/flash_%d.bin", root ? root : ".", SCEWL_ID);
+  fd = open(path, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) {
+    perror(path);
+    return;
+  }
+  len = pread(fd, host_flash, sizeof(host_flash), 0);
+  if (len < (ssize_t)sizeof(host_flash)) {
+    memset(host_flash + (len > 0 ? len : 0), 0xff, sizeof(host_flash) - (len > 0 ? len : 0));
+    flash_sync(0, sizeof(host_flash));
+  }
+}
+
+
+void flash_erase(uint32_t off) {
+  off -= off % FLASH_PAGE_SZ;
+  memset(host_flash + off, 0xff, FLASH_PAGE_SZ);
+  flash_sync(off, FLASH_PAGE_SZ);
+}
+
+
+void flash_write(uint32_t off, const uint32_t *words, int n) {
+  uint32_t *p = (uint32_t *)(host_flash + off);
+
+  for (int i = 0; i < n; i++) {
+    p[i] &= words[i];
+  }
+  flash_sync(off, n * 4);
+}
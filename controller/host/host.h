@@ -0,0 +1,64 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller hosted build header
+ *
+ * Stands in for lm3s/lm3s_cmsis.h when the controller is built as a Linux
+ * program (see `make host`). Each interface is one of the Unix sockets QEMU
+ * would attach the matching UART to with `-serial unix:` in
+ * tools/launch_sed.sh, under the directory in $SOCK_ROOT (/socks if unset):
+ *   CPU_INTF - scewl_bus_<SCEWL_ID>.sock, listened on for the CPU
+ *   SSS_INTF - sss.sock, connected to
+ *   RAD_INTF - antenna_<SCEWL_ID>.sock, connected to
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// core clock the hosted build reports, the same as the target's so that
+// timeouts and periods given in cycles mean the same time
+#define HOST_HZ 50000000
+
+// socket behind an interface, with bytes received ahead of being read
+typedef struct intf_t {
+  const char *name;  // socket file name, %d replaced by SCEWL_ID
+  int listen;        // 1 to listen for a client, 0 to connect to a server
+  int fd;
+  uint16_t rx_pos, rx_len;
+  uint8_t rx[512];
+} intf_t;
+
+extern intf_t host_intfs[3];
+
+#define CPU_INTF (&host_intfs[0])
+#define SSS_INTF (&host_intfs[1])
+#define RAD_INTF (&host_intfs[2])
+
+
+/*
+ * host_tick_ms
+ *
+ * Returns:
+ *   the period set with clock_systick or clock_period in milliseconds, which
+ *   is the longest intf_wait sleeps for, as it would between SysTicks
+ */
+int host_tick_ms(void);
+
+
+// the flash reserved for the warm-start log, erased at start
+extern uint8_t host_flash[];
+
+// persist.c's flash primitives, taking byte offsets into host_flash
+void flash_setup(void);
+void flash_erase(uint32_t off);
+void flash_write(uint32_t off, const uint32_t *words, int n);
+
+#endif // HOST_H
@@ -0,0 +1,179 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller hosted interface implementation
+ *
+ * Implements interface.h over the Unix sockets described in host/host.h
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "interface.h"
+#include "controller.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+intf_t host_intfs[3] = {
+  { "scewl_bus_%d.sock", 1 },
+  { "sss.sock", 0 },
+  { "antenna_%d.sock", 0 },
+};
+
+
+// the controller cannot do anything useful once an interface is gone, the
+// same as QEMU exiting when a socket closes
+static void intf_fail(intf_t *intf, const char *what) {
+  fprintf(stderr, "controller %d: %s: ", SCEWL_ID, intf->name);
+  if (errno) {
+    perror(what);
+  } else {
+    fprintf(stderr, "%s\n", what);
+  }
+  exit(1);
+}
+
+
+// initialize the interface
+void intf_init(intf_t *intf) {
+  struct sockaddr_un addr;
+  const char *root = getenv("SOCK_ROOT");
+  char name[64];
+  int fd;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(name, sizeof(name), intf->name, SCEWL_ID);
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/%s", root ? root : "/socks", name);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    intf_fail(intf, "socket");
+  }
+
+  if (intf->listen) {
+    // wait for the CPU to connect, like QEMU's `server` option
+    unlink(addr.sun_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+      intf_fail(intf, "bind");
+    }
+    intf->fd = accept(fd, NULL, NULL);
+    close(fd);
+    if (intf->fd < 0) {
+      intf_fail(intf, "accept");
+    }
+  } else {
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      intf_fail(intf, "connect");
+    }
+    intf->fd = fd;
+  }
+
+  intf->rx_pos = intf->rx_len = 0;
+}
+
+
+// returns if the interface is available to read from
+int intf_avail(intf_t *intf) {
+  ssize_t n;
+
+  if (intf->rx_pos < intf->rx_len) {
+    return 1;
+  }
+
+  n = recv(intf->fd, intf->rx, sizeof(intf->rx), MSG_DONTWAIT);
+  if (n > 0) {
+    intf->rx_pos = 0;
+    intf->rx_len = n;
+    return 1;
+  }
+
+  if (n == 0) {
+    errno = 0;
+    intf_fail(intf, "closed");
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    intf_fail(intf, "recv");
+  }
+  return 0;
+}
+
+
+// sleep until one of the interfaces has data, or for a tick at most
+void intf_wait(intf_t **intfs, int n) {
+  struct pollfd fds[3];
+
+  for (int i = 0; i < n; i++) {
+    if (intf_avail(intfs[i])) {
+      return;
+    }
+    fds[i].fd = intfs[i]->fd;
+    fds[i].events = POLLIN;
+  }
+
+  poll(fds, n, host_tick_ms());
+}
+
+
+// read a byte from the interface
+int intf_readb(intf_t *intf, int blocking) {
+  // block if requested
+  while (blocking && !intf_avail(intf)) {
+    intf_wait(&intf, 1);
+  }
+
+  // return no data if no data is available
+  if (!intf_avail(intf)) {
+    return INTF_NO_DATA;
+  }
+
+  return intf->rx[intf->rx_pos++];
+}
+
+
+// read from the interface. Unlike on the UARTs, bytes arrive in bulk and
+// there is nothing to wait for between them
+int intf_read(intf_t *intf, char *buf, size_t n, int blocking) {
+  int read;
+  int b;
+
+  for (read = 0; read < n; read++) {
+    b = intf_readb(intf, blocking);
+    if (b < 0) {
+      return INTF_NO_DATA;
+    }
+    ((uint8_t *)buf)[read] = (uint8_t)b;
+  }
+  return read;
+}
+
+
+// write a byte to the interface
+void intf_writeb(intf_t *intf, uint8_t data) {
+  intf_write(intf, &data, 1);
+}
+
+
+// write the the interface
+int intf_write(intf_t *intf, void *buf, int16_t len) {
+  ssize_t n;
+
+  for (int sent = 0; sent < len; sent += n) {
+    n = send(intf->fd, (uint8_t *)buf + sent, len - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno != EINTR) {
+      intf_fail(intf, "send");
+    }
+    if (n < 0) {
+      n = 0;
+    }
+  }
+  return len;
+}
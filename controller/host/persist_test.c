@@ -0,0 +1,121 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller warm-start log test
+ *
+ * Runs persist.c over host/flash.c through clean restarts, writes torn by a
+ * reset and a log left with no intact record. Built and run with
+ * `make persist_test SCEWL_ID=<id>`, keeping the flash in a temporary
+ * directory
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "persist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failed;
+
+#define CHECK(cond) do {                                        \
+    if (!(cond)) {                                              \
+      fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); \
+      failed++;                                                 \
+    }                                                           \
+  } while (0)
+
+
+// save a record, marked in its registration field so the tests can tell
+// which one is resumed, and return the slot it went to
+static int save(uint16_t mark, uint32_t epoch) {
+  static uint8_t before[PERSIST_SLOTS * PERSIST_REC_SZ];
+  persist_state_t st = { mark, epoch };
+
+  memcpy(before, host_flash, sizeof(before));
+  persist_save(&st);
+  for (int slot = 0; slot < PERSIST_SLOTS; slot++) {
+    if (memcmp(before + slot * PERSIST_REC_SZ, host_flash + slot * PERSIST_REC_SZ, PERSIST_REC_SZ)) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+
+// leave the last word of a record unwritten, as a reset during the write would
+static void tear(int slot) {
+  memset(host_flash + (slot + 1) * PERSIST_REC_SZ - 4, 0xff, 4);
+}
+
+
+// restart and load, returning the mark of the record resumed or 0 if there
+// is none, and the epoch to move past
+static int boot(uint32_t *epoch) {
+  persist_state_t st;
+  int res = persist_load(&st);
+
+  *epoch = st.epoch;
+  return res ? st.registered : 0;
+}
+
+
+int main() {
+  char root[] = "/tmp/persist_test.XXXXXX", path[64];
+  uint32_t epoch;
+  int slot;
+
+  if (!mkdtemp(root)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  setenv("FLASH_ROOT", root, 1);
+
+  // an erased log starts cold, then resumes from what was saved
+  CHECK(boot(&epoch) == 0 && epoch == 0);
+  save(1, 1);
+  CHECK(boot(&epoch) == 1 && epoch == 1);
+  save(2, 2);
+  CHECK(boot(&epoch) == 2 && epoch == 2);
+
+  // a torn write falls back to the record before it, but neither the next
+  // record nor the next epoch reuse the torn one's numbers
+  tear(save(3, 3));
+  CHECK(boot(&epoch) == 2 && epoch == 3);
+  save(4, 4);
+  CHECK(boot(&epoch) == 4 && epoch == 4);
+  save(5, 5);
+  CHECK(boot(&epoch) == 5 && epoch == 5);
+
+  // an intact record sharing its sequence number with a torn one is found
+  slot = save(6, 6);
+  memcpy(host_flash + (slot + 1) * PERSIST_REC_SZ, host_flash + slot * PERSIST_REC_SZ, PERSIST_REC_SZ);
+  tear(slot);
+  CHECK(boot(&epoch) == 6 && epoch == 6);
+  save(7, 7);
+  CHECK(boot(&epoch) == 7 && epoch == 7);
+
+  // the log wraps around its pages without losing the newest record
+  for (int i = 8; i < 8 + 2 * PERSIST_SLOTS; i++) {
+    save(i, i);
+  }
+  CHECK(boot(&epoch) == 7 + 2 * PERSIST_SLOTS && epoch == 7 + 2 * PERSIST_SLOTS);
+
+  // with every record torn, nothing is resumed but the epoch still moves on
+  for (slot = 0; slot < PERSIST_SLOTS; slot++) {
+    tear(slot);
+  }
+  CHECK(boot(&epoch) == 0 && epoch == 7 + 2 * PERSIST_SLOTS);
+
+  snprintf(path, sizeof(path), "%s/flash_%d.bin", root, SCEWL_ID);
+  unlink(path);
+  rmdir(root);
+
+  printf("persist_test: %s\n", failed ? "FAILED" : "ok");
+  return failed != 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller hosted stack watermark
+ *
+ * Implements stack.h for the hosted build. The host stack is neither
+ * reserved by the linker script nor painted at reset, so both are reported
+ * as 0 rather than a number that means nothing on the target
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "stack.h"
+
+
+uint32_t stack_size(void) {
+  return 0;
+}
+
+
+uint32_t stack_used(void) {
+  return 0;
+}
@@ -11,6 +11,7 @@
  */
 
 #include "interface.h"
+#include "clock.h"
 
 
 // read/write available status masks
@@ -20,14 +21,54 @@ enum {
 };
 
 
+// receive and receive timeout interrupt masks
+enum {
+ RXIM = 0x10,
+ RTIM = 0x40,
+};
+
+
+// interrupt line of an interface
+static IRQn_Type intf_irq(intf_t *intf) {
+  if (intf == UART0) {
+    return UART0_IRQn;
+  } else if (intf == UART1) {
+    return UART1_IRQn;
+  }
+  return USART2_IRQn;
+}
+
+
+// receive interrupts only wake the core from intf_wait; mask them again and
+// leave the data for the main loop to read
+void UART0_IRQHandler(void) {
+  UART0->IM &= ~(RXIM | RTIM);
+}
+
+void UART1_IRQHandler(void) {
+  UART1->IM &= ~(RXIM | RTIM);
+}
+
+void UART2_IRQHandler(void) {
+  UART2->IM &= ~(RXIM | RTIM);
+}
+
+
 // initialize the interface
 extern void intf_init(intf_t *intf) {
+  // baud rate divisor in 1/64ths: clock / (16 * baud), rounded
+  uint32_t div = (clock_hz() * 4 + INTF_BAUD / 2) / INTF_BAUD;
+
   // per TRM p.439 https://www.ti.com/lit/ds/symlink/lm3s6965.pdf
   intf->CTL &= 0xfffffffe;
-  intf->IBRD = (intf->IBRD & 0xffff0000) | 0x000a;
-  intf->FBRD = (intf->FBRD & 0xffff0000) | 0x0036;
+  intf->IBRD = (intf->IBRD & 0xffff0000) | (div >> 6);
+  intf->FBRD = (intf->FBRD & 0xffff0000) | (div & 0x3f);
   intf->LCRH = 0x00000060;
   intf->CTL |= 0x00000001;
+
+  // receive interrupts stay masked until intf_wait needs them
+  intf->IM = 0;
+  NVIC_EnableIRQ(intf_irq(intf));
 }
 
 
@@ -37,10 +78,35 @@ int intf_avail(intf_t *intf) {
 }
 
 
+// sleep until one of the interfaces has data
+void intf_wait(intf_t **intfs, int n) {
+  // with interrupts off, a byte arriving between the check and WFI still
+  // wakes the core instead of being missed
+  __disable_irq();
+
+  for (int i = 0; i < n; i++) {
+    if (intf_avail(intfs[i])) {
+      __enable_irq();
+      return;
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    intfs[i]->IM |= RXIM | RTIM;
+  }
+  __WFI();
+
+  // let the handler mask the interrupt that woke us
+  __enable_irq();
+}
+
+
 // read a byte from the interface
 int intf_readb(intf_t *intf, int blocking) {
   // block if requested
-  while (blocking && !intf_avail(intf));
+  while (blocking && !intf_avail(intf)) {
+    intf_wait(&intf, 1);
+  }
 
   // return no data if no data is available
   if (!intf_avail(intf)) {
@@ -63,8 +129,9 @@ int intf_read(intf_t *intf, char *buf, size_t n, int blocking) {
     }
     ((uint8_t *)buf)[read] = (uint8_t)b;
 
-    // give QEMU some time to queue the next byte if it's there
-    for (int i = 0; i < 100000; i++) *buf = *buf;
+    // give QEMU some time to queue the next byte if it's there (volatile so
+    // optimized builds keep the delay)
+    for (int i = 0; i < 100000; i++) *(volatile char *)buf = *buf;
   }
   return read;
 }
@@ -12,7 +12,30 @@
 
 #ifndef INTERFACE_H
 #define INTERFACE_H
+
+// hosted builds (see `make host`) run as a Linux program with the interfaces
+// backed by Unix sockets instead of UARTs
+#ifdef HOSTED
+#include "host/host.h"
+#else
 #include "lm3s/lm3s_cmsis.h"
+#endif
+
+// marks a function on the message path. Release builds (see RELEASE in the
+// Makefile) optimize these for speed while everything else is built for size
+#ifdef RELEASE
+#define HOT __attribute__((hot, optimize("O2")))
+#else
+#define HOT
+#endif
+
+// places a variable in .noinit, which Reset_Handler does not zero. For large
+// buffers that are always written before they are read, and for state that
+// has to be set up before memory is initialized
+#ifdef HOSTED
+#define NOINIT
+#else
+#define NOINIT __attribute__((section(".noinit")))
 
 typedef UART_Type intf_t;
 typedef unsigned int size_t;
@@ -20,6 +43,10 @@ typedef unsigned int size_t;
 #define CPU_INTF UART0
 #define SSS_INTF UART1
 #define RAD_INTF UART2
+#endif
+
+// line rate of every interface
+#define INTF_BAUD      115200
 
 #define INTF_ERR       (-1)
 #define INTF_NO_DATA   (-2)
@@ -46,6 +73,20 @@ void intf_init(intf_t *intf);
 int intf_avail(intf_t *intf);
 
 
+/*
+ * intf_wait
+ *
+ * Sleeps with WFI until at least one of the interfaces has data, returning
+ * right away if one already does. May also return early on other interrupts,
+ * so callers check intf_avail again
+ *
+ * Args:
+ *   intfs - array of pointers to initialized interface devices
+ *   n - number of interfaces in the array
+ */
+void intf_wait(intf_t **intfs, int n);
+
+
 /*
  * intf_readb
  *
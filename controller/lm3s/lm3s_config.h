@@ -239,6 +239,28 @@
 
 //-------- <<< end of configuration section >>> ------------------------------
 
+//
+// Full speed configuration, selected with PLL_50MHZ (see controller/Makefile).
+// The 8 MHz main crystal of the LM3S6965 EVB drives the 200 MHz PLL, divided
+// by 4 for the part's maximum system clock of 50 MHz.
+//
+#ifdef PLL_50MHZ
+#undef CFG_RCC_SYSDIV
+#undef CFG_RCC_USESYSDIV
+#undef CFG_RCC_PWRDN
+#undef CFG_RCC_BYPASS
+#undef CFG_RCC_XTAL
+#undef CFG_RCC_OSCSRC
+#undef CFG_RCC_MOSCDIS
+#define CFG_RCC_SYSDIV 4
+#define CFG_RCC_USESYSDIV 1
+#define CFG_RCC_PWRDN 0
+#define CFG_RCC_BYPASS 0
+#define CFG_RCC_XTAL 14
+#define CFG_RCC_OSCSRC 0
+#define CFG_RCC_MOSCDIS 0
+#endif
+
 //
 // The following macros are used to program the RCC and RCC2 registers in
 // the SystemInit() function.  Edit the macros above to change these values.
@@ -25,6 +25,10 @@
 //
 //*****************************************************************************
 
+#include "clock.h"
+#include "boot.h"
+#include "stack.h"
+
 #define WEAK __attribute__ ((weak))
 
 //*****************************************************************************
@@ -95,6 +99,7 @@ void WEAK Hibernate_IRQHandler(void);
 //
 //*****************************************************************************
 extern int main(void);
+extern void SystemInit(void);
 
 //*****************************************************************************
 //
@@ -205,31 +210,73 @@ extern unsigned long _ebss;
 void
 Reset_Handler(void)
 {
-    unsigned long *pulSrc, *pulDest;
+    //
+    // Start the cycle counter and the boot timeline.  Both keep their state in
+    // .noinit, which the loops below leave alone.
+    //
+    clock_systick(0);
+    boot_stamp(BOOT_RESET);
 
     //
-    // Copy the data segment initializers from flash to SRAM.
+    // Switch to the real stack, copy the data segment initializers from flash
+    // to SRAM, zero fill the bss segment and paint the stack with STACK_PAINT
+    // for stack_used.  All three move four words per LDM/STM and finish with
+    // single words.  This is done in assembly so nothing is kept on the stack
+    // while memory is being initialized.
     //
-    pulSrc = &_etext;
-    for(pulDest = &_data; pulDest < &_edata; )
-    {
-        *pulDest++ = *pulSrc++;
-    }
+    __asm volatile("    ldr     sp, =_stack_top\n"
+                   "    ldr     r0, =_etext\n"
+                   "    ldr     r1, =_data\n"
+                   "    ldr     r2, =_edata\n"
+                   "1:  sub     r3, r2, r1\n"
+                   "    cmp     r3, #16\n"
+                   "    blt     2f\n"
+                   "    ldmia   r0!, {r3, r4, r5, r6}\n"
+                   "    stmia   r1!, {r3, r4, r5, r6}\n"
+                   "    b       1b\n"
+                   "2:  cmp     r1, r2\n"
+                   "    itt     lt\n"
+                   "    ldrlt   r3, [r0], #4\n"
+                   "    strlt   r3, [r1], #4\n"
+                   "    blt     2b\n"
+                   "    ldr     r0, =_bss\n"
+                   "    ldr     r1, =_ebss\n"
+                   "    mov     r3, #0\n"
+                   "    mov     r4, #0\n"
+                   "    mov     r5, #0\n"
+                   "    mov     r6, #0\n"
+                   "3:  sub     r2, r1, r0\n"
+                   "    cmp     r2, #16\n"
+                   "    blt     4f\n"
+                   "    stmia   r0!, {r3, r4, r5, r6}\n"
+                   "    b       3b\n"
+                   "4:  cmp     r0, r1\n"
+                   "    it      lt\n"
+                   "    strlt   r3, [r0], #4\n"
+                   "    blt     4b\n"
+                   "    ldr     r0, =_stack_bottom\n"
+                   "    ldr     r1, =_stack_top\n"
+                   "    ldr     r3, =%c0\n"
+                   "    mov     r4, r3\n"
+                   "    mov     r5, r3\n"
+                   "    mov     r6, r3\n"
+                   "5:  sub     r2, r1, r0\n"
+                   "    cmp     r2, #16\n"
+                   "    blt     6f\n"
+                   "    stmia   r0!, {r3, r4, r5, r6}\n"
+                   "    b       5b\n"
+                   "6:  cmp     r0, r1\n"
+                   "    it      lt\n"
+                   "    strlt   r3, [r0], #4\n"
+                   "    blt     6b\n"
+                   : : "i" (STACK_PAINT) : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "memory");
+    boot_stamp(BOOT_DATA);
 
     //
-    // Zero fill the bss segment.  This is done with inline assembly since this
-    // will clear the value of pulDest if it is not kept in a register.
+    // Set up the system clock and SystemFrequency before anything uses them.
     //
-    __asm("    ldr     r0, =_bss\n"
-          "    ldr     r1, =_ebss\n"
-          "    mov     r2, #0\n"
-          "    ldr     sp, =_stack_top\n"
-          "    .thumb_func\n"
-          "zero_loop:\n"
-          "        cmp     r0, r1\n"
-          "        it      lt\n"
-          "        strlt   r2, [r0], #4\n"
-          "        blt     zero_loop");
+    SystemInit();
+    boot_stamp(BOOT_CLOCK);
 
     //
     // Call the application's entry point.
@@ -109,11 +109,8 @@ void SystemInit (void) {
       SystemFrequency = PLL_CLK;
     }
     if (rcc & (1UL<<22)) {                            /* check USESYSDIV */
-      if (rcc2 & (1UL<<11)) {
-        SystemFrequency = SystemFrequency / (((rcc2>>23) & (0x3F)) + 1);
-      } else {
-        SystemFrequency = SystemFrequency / (((rcc2>>23) & (0x3F)) + 1) / 2;
-      }
+      /* divided by SYSDIV2 + 1 with or without the PLL */
+      SystemFrequency = SystemFrequency / (((rcc2>>23) & (0x3F)) + 1);
     }
   } else {
     if (RCC_Val & (1UL<<11)) {                            /* check BYPASS */
@@ -123,12 +120,8 @@ void SystemInit (void) {
       SystemFrequency = PLL_CLK;
     }
     if (rcc & (1UL<<22)) {                            /* check USESYSDIV */
-//      if (rcc & (1UL<<11)) {                          /* check BYPASS */ /* Simulation does not work at theis point */
-      if (RCC_Val & (1UL<<11)) {                          /* check BYPASS */
-        SystemFrequency = SystemFrequency / (((rcc>>23) & (0x0F)) + 1);
-      } else {
-        SystemFrequency = SystemFrequency / (((rcc>>23) & (0x0F)) + 1) / 2;
-      }
+      /* divided by SYSDIV + 1 with or without the PLL */
+      SystemFrequency = SystemFrequency / (((rcc>>23) & (0x0F)) + 1);
     }
   }
 
@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# 2021 Collegiate eCTF
+# SRAM budget report
+#
+# (c) 2021 The MITRE Corporation
+#
+# This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+# This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+# and may not meet MITRE standards for quality. Use this code at your own risk!
+
+# Usage: mem_report.sh <tool prefix> <image.axf> <object dir>
+#
+# Prints SRAM use of a linked image by symbol: each object in .data, .bss and
+# .noinit, the stack reservation, and the largest stack frames from the
+# -fstack-usage files next to the objects. Called by the Makefile
+
+set -e
+
+PREFIX=$1
+AXF=$2
+OBJDIR=$3
+TOP=${TOP:-20}
+
+# objdump -t lines look like "addr flags section<TAB>size name"
+SYMS=`${PREFIX}-objdump -t ${AXF}`
+
+# largest objects in a section, after its total
+section() {
+    LIST=`echo "$SYMS" | awk -F'\t' -v sec=$1 '
+        function hex(s,    i, v) {
+            v = 0
+            for (i = 1; i <= length(s); i++) {
+                v = v * 16 + index("0123456789abcdef", tolower(substr(s, i, 1))) - 1
+            }
+            return v
+        }
+        {
+            n = split($1, a, " ")
+            split($2, b, " ")
+            if (a[n] == sec && hex(b[1])) print hex(b[1]), b[2]
+        }' | sort -rn`
+
+    echo "$1: `echo "$LIST" | awk '{ t += $1 } END { print t + 0 }'` bytes"
+    echo "$LIST" | head -n $TOP | awk 'NF { printf "  %8d  %s\n", $1, $2 }'
+}
+
+for s in .data .bss .noinit; do
+    section $s
+    echo
+done
+
+# section sizes from the headers; the .stack section is only the reservation
+size_of() {
+    echo $((16#`${PREFIX}-objdump -h ${AXF} | awk -v sec=$1 '$2 == sec { s = $3 } END { print s ? s : 0 }'`))
+}
+STACK=`size_of .stack`
+USED=$((`size_of .data` + `size_of .bss` + `size_of .noinit` + STACK))
+
+echo "stack: ${STACK} bytes reserved, largest frames:"
+cat ${OBJDIR}/*.su 2>/dev/null | awk -F'\t' '{ n = split($1, a, ":"); print $2, a[n] }' | \
+    sort -rn | head -n $TOP | awk '{ printf "  %8d  %s\n", $1, $2 }'
+
+echo
+echo "SRAM: ${USED} of ${SRAM_SZ:-65536} bytes allocated"
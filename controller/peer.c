@@ -0,0 +1,180 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller peer table implementation
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "peer.h"
+
+// open-addressed table of known peers. Entries are only ever replaced in
+// place, never emptied, so no probe sequence is cut short
+peer_t peers[PEER_TABLE_SZ];
+
+// open-addressed table of floors of evicted peers, never emptied either
+static peer_floor_t floors[PEER_FLOOR_SZ];
+
+// ticks once per accepted frame, for peer_t.last
+static uint32_t now;
+
+
+void peer_reset(void) {
+  memset(peers, 0, sizeof(peers));
+  memset(floors, 0, sizeof(floors));
+  now = 0;
+}
+
+
+// find a peer's entry, or the first free slot on its probe sequence
+HOT static peer_t *peer_probe(scewl_id_t id) {
+  peer_t *peer;
+
+  // linear probe from the home slot; SCEWL IDs are handed out densely, so
+  // the low bits alone spread them well
+  for (int i = 0; i < PEER_TABLE_SZ; i++) {
+    peer = &peers[(id + i) & (PEER_TABLE_SZ - 1)];
+    if (!(peer->flags & PEER_USED) || peer->id == id) {
+      return peer;
+    }
+  }
+
+  // table full
+  return NULL;
+}
+
+
+// find a peer's floor, or the first free slot on its probe sequence
+static peer_floor_t *floor_probe(scewl_id_t id) {
+  peer_floor_t *fl;
+
+  for (int i = 0; i < PEER_FLOOR_SZ; i++) {
+    fl = &floors[(id + i) & (PEER_FLOOR_SZ - 1)];
+    if (!(fl->flags & PEER_USED) || fl->id == id) {
+      return fl;
+    }
+  }
+
+  // floors full
+  return NULL;
+}
+
+
+// window that rejects everything at or below a peer's floor, or an empty one
+// if the peer was never evicted
+static void floor_window(scewl_id_t id, replay_window_t *w) {
+  peer_floor_t *fl = floor_probe(id);
+
+  if (fl && (fl->flags & PEER_USED)) {
+    w->epoch = fl->epoch;
+    w->top = fl->seq;
+    w->bitmap = ~(uint64_t)0;
+  } else {
+    memset(w, 0, sizeof(replay_window_t));
+  }
+}
+
+
+HOT int peer_check(scewl_id_t id, uint32_t epoch, uint32_t seq) {
+  peer_t *peer = peer_probe(id);
+  replay_window_t w;
+
+  if (peer && (peer->flags & PEER_USED)) {
+    return replay_check(&peer->rx, epoch, seq);
+  }
+
+  floor_window(id, &w);
+  return replay_check(&w, epoch, seq);
+}
+
+
+HOT int peer_record(scewl_id_t id, uint32_t epoch, uint32_t seq) {
+  peer_t *peer = peer_probe(id);
+  peer_floor_t *fl;
+
+  if (!peer) {
+    // evict the peer heard from longest ago, keeping its newest frame as
+    // its floor so its old frames stay rejected
+    peer = &peers[0];
+    for (int i = 1; i < PEER_TABLE_SZ; i++) {
+      if (now - peers[i].last > now - peer->last) {
+        peer = &peers[i];
+      }
+    }
+    fl = floor_probe(peer->id);
+    if (!fl) {
+      return 0;
+    }
+    fl->id = peer->id;
+    fl->flags = PEER_USED;
+    fl->epoch = peer->rx.epoch;
+    fl->seq = peer->rx.top;
+  }
+
+  if (!(peer->flags & PEER_USED) || peer->id != id) {
+    // first contact, or back after eviction
+    peer->id = id;
+    peer->flags = PEER_USED;
+    floor_window(id, &peer->rx);
+  }
+  peer->last = ++now;
+  replay_update(&peer->rx, epoch, seq);
+  return 1;
+}
+
+
+HOT int replay_check(const replay_window_t *w, uint32_t epoch, uint32_t seq) {
+  uint32_t diff;
+
+  // empty window
+  if (!w->bitmap) {
+    return 1;
+  }
+
+  // a restarted peer moves on to a later epoch, so frames from an earlier
+  // one can only be replays
+  if (epoch != w->epoch) {
+    return epoch > w->epoch;
+  }
+
+  // ahead of the window
+  if (seq > w->top) {
+    return 1;
+  }
+
+  // behind the window
+  diff = w->top - seq;
+  if (diff >= REPLAY_WINDOW_SZ) {
+    return 0;
+  }
+
+  // inside the window, accept if not seen yet
+  return !(w->bitmap & ((uint64_t)1 << diff));
+}
+
+
+HOT void replay_update(replay_window_t *w, uint32_t epoch, uint32_t seq) {
+  uint32_t diff;
+
+  // start a fresh window, for first contact or a later epoch
+  if (!w->bitmap || epoch != w->epoch) {
+    w->epoch = epoch;
+    w->top = seq;
+    w->bitmap = 1;
+    return;
+  }
+
+  if (seq > w->top) {
+    // slide the window forward
+    diff = seq - w->top;
+    w->bitmap = diff < REPLAY_WINDOW_SZ ? (w->bitmap << diff) | 1 : 1;
+    w->top = seq;
+  } else {
+    // mark a late frame
+    w->bitmap |= (uint64_t)1 << (w->top - seq);
+  }
+}
+
@@ -0,0 +1,137 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller peer table header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef PEER_H
+#define PEER_H
+
+#include "controller.h"
+
+#include <stdint.h>
+
+// number of peers tracked at once (must be a power of 2)
+#define PEER_TABLE_SZ 64
+
+// number of evicted peers whose replay floor is remembered (must be a power
+// of 2). Floors are never forgotten, so this bounds how many distinct peers
+// are accepted at all: PEER_TABLE_SZ + PEER_FLOOR_SZ
+#define PEER_FLOOR_SZ 256
+
+// number of sequence numbers behind the newest one that are still accepted.
+// radio_waves.py forwards each antenna in order, so only a MitM or a burst of
+// back-to-back sends can reorder frames; 64 leaves plenty of slack for both
+#define REPLAY_WINDOW_SZ 64
+
+// peer entry flags
+enum peer_flags { PEER_USED = 0x1 };
+
+// sliding anti-replay window over a peer's message counters (RFC 4303 style)
+typedef struct replay_window_t {
+  uint32_t epoch;   // boot epoch of the peer the window belongs to
+  uint32_t top;     // highest sequence number accepted so far
+  uint64_t bitmap;  // bit i set if sequence number (top - i) was accepted
+} replay_window_t;
+
+// per-peer state, fixed size regardless of traffic
+typedef struct peer_t {
+  scewl_id_t id;
+  uint16_t   flags;
+  uint32_t   last;  // when a frame from the peer was last accepted
+  replay_window_t rx;
+} peer_t;
+
+// newest (epoch, seq) accepted from a peer when its window was evicted
+typedef struct peer_floor_t {
+  scewl_id_t id;
+  uint16_t   flags;
+  uint32_t   epoch;
+  uint32_t   seq;
+} peer_floor_t;
+
+
+/*
+ * peer_reset
+ *
+ * Forgets all peers and their floors. Only for benchmarks; the controller
+ * keeps its peers for as long as it runs
+ */
+void peer_reset(void);
+
+
+/*
+ * peer_check
+ *
+ * Runs the replay check for a frame from a peer without recording it, so it
+ * can run before the frame is authenticated. Peers whose window was evicted
+ * are checked against their floor, so nothing at or below the newest frame
+ * accepted from them is accepted again
+ *
+ * Args:
+ *   id - SCEWL ID of the peer
+ *   epoch - boot epoch the sequence number belongs to
+ *   seq - sequence number of the frame
+ *
+ * Returns:
+ *   1 if the frame is new, 0 if it is a replay or too old
+ */
+int peer_check(scewl_id_t id, uint32_t epoch, uint32_t seq);
+
+
+/*
+ * peer_record
+ *
+ * Marks a frame from a peer as seen, allocating the peer a window on first
+ * contact or after eviction. Must only be called for authentic frames that
+ * peer_check accepted, so forged source IDs cannot fill the table. Once the
+ * table is full, the peer heard from longest ago is evicted to a floor
+ *
+ * Args:
+ *   id - SCEWL ID of the peer
+ *   epoch - boot epoch the sequence number belongs to
+ *   seq - sequence number of the frame
+ *
+ * Returns:
+ *   1 if the frame was recorded, 0 if the floors are full too, in which
+ *   case nothing is evicted and the frame must be dropped
+ */
+int peer_record(scewl_id_t id, uint32_t epoch, uint32_t seq);
+
+
+/*
+ * replay_check
+ *
+ * Checks a sequence number against a window without updating it
+ *
+ * Args:
+ *   w - pointer to the window
+ *   epoch - boot epoch the sequence number belongs to
+ *   seq - sequence number of the frame
+ *
+ * Returns:
+ *   1 if the frame is new, 0 if it is a replay, too old or from an earlier
+ *   epoch than the window
+ */
+int replay_check(const replay_window_t *w, uint32_t epoch, uint32_t seq);
+
+
+/*
+ * replay_update
+ *
+ * Marks a sequence number as seen. Must only be called after replay_check
+ * accepted the same epoch and sequence number
+ *
+ * Args:
+ *   w - pointer to the window
+ *   epoch - boot epoch the sequence number belongs to
+ *   seq - sequence number of the frame
+ */
+void replay_update(replay_window_t *w, uint32_t epoch, uint32_t seq);
+
+#endif // PEER_H
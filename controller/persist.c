@@ -0,0 +1,222 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller warm-start log
+ *
+ * Each record carries a magic word, a sequence number and a truncated
+ * HMAC-SHA-256 tag under a key derived from the per-SED secret. Erased,
+ * torn, foreign and old-build records all fail one of those checks and are
+ * skipped, so anything but a clean record from this SED's current build
+ * leaves the controller to register from scratch
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "persist.h"
+#include "controller.h"
+#include "sha256.h"
+#include "clock.h"
+#include "secrets.h"
+
+#define PERSIST_MAGIC 0x5343574c  // "SCWL"
+#define PERSIST_LABEL "SCEWL persist key"
+#define PERSIST_TAG_SZ 16
+
+// flash controller command keys and bits, per TRM p.300
+#define FMC_WRKEY 0xa4420000
+#define FMC_WRITE 0x1
+#define FMC_ERASE 0x2
+
+// one log record as stored in flash
+typedef struct persist_rec_t {
+  uint32_t magic;
+  uint32_t seq;     // increases with every record written
+  uint16_t id;      // SCEWL ID of the SED that wrote it
+  uint16_t registered;
+  uint32_t epoch;
+  uint8_t  tag[PERSIST_TAG_SZ];
+} persist_rec_t;
+
+typedef char persist_rec_size_check[sizeof(persist_rec_t) == PERSIST_REC_SZ ? 1 : -1];
+
+static const uint8_t sed_secret[SHA256_DIGEST_SZ] = SED_SECRET;
+
+// record key, derived from the per-SED secret
+static hmac_sha256_key_t persist_key;
+
+// sequence number and slot of the next record
+static uint32_t next_seq;
+static int next_slot;
+
+
+#ifdef HOSTED
+// the hosted build keeps the log in host_flash instead, see host/flash.c
+#define LOG_BASE host_flash
+#else
+#define LOG_BASE ((const uint8_t *)PERSIST_BASE)
+#endif
+
+
+static const persist_rec_t *slot_rec(int slot) {
+  return (const persist_rec_t *)(LOG_BASE + slot * PERSIST_REC_SZ);
+}
+
+
+// tag over everything before the tag, which is the last field
+static void rec_tag(const persist_rec_t *rec, uint8_t *tag) {
+  hmac_sha256_ctx_t ctx;
+  uint8_t mac[SHA256_DIGEST_SZ];
+
+  hmac_sha256_init_key(&ctx, &persist_key);
+  hmac_sha256_update(&ctx, rec, sizeof(persist_rec_t) - PERSIST_TAG_SZ);
+  hmac_sha256_final(&ctx, mac);
+  memcpy(tag, mac, PERSIST_TAG_SZ);
+}
+
+
+// cheap checks, before the tag is worth computing
+static int rec_plausible(const persist_rec_t *rec) {
+  return rec->magic == PERSIST_MAGIC && rec->id == SCEWL_ID;
+}
+
+
+static int rec_authentic(const persist_rec_t *rec) {
+  uint8_t tag[PERSIST_TAG_SZ];
+  uint8_t diff = 0;
+
+  rec_tag(rec, tag);
+  for (int i = 0; i < PERSIST_TAG_SZ; i++) {
+    diff |= tag[i] ^ rec->tag[i];
+  }
+  return !diff;
+}
+
+
+static int slot_erased(int slot) {
+  const uint32_t *p = (const uint32_t *)slot_rec(slot);
+
+  for (int i = 0; i < PERSIST_REC_SZ / 4; i++) {
+    if (p[i] != 0xffffffff) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+#ifndef HOSTED
+// the flash controller times program and erase pulses in microseconds
+static void flash_setup(void) {
+  FLASH_CTRL->USECRL = clock_hz() / 1000000 - 1;
+}
+
+
+static void flash_erase(uint32_t off) {
+  FLASH_CTRL->FMA = PERSIST_BASE + off;
+  FLASH_CTRL->FMC = FMC_WRKEY | FMC_ERASE;
+  while (FLASH_CTRL->FMC & FMC_ERASE);
+}
+
+
+static void flash_write(uint32_t off, const uint32_t *words, int n) {
+  for (int i = 0; i < n; i++) {
+    FLASH_CTRL->FMA = PERSIST_BASE + off + i * 4;
+    FLASH_CTRL->FMD = words[i];
+    FLASH_CTRL->FMC = FMC_WRKEY | FMC_WRITE;
+    while (FLASH_CTRL->FMC & FMC_WRITE);
+  }
+}
+#endif
+
+
+int persist_load(persist_state_t *st) {
+  const persist_rec_t *rec, *best;
+  uint32_t rejected[(PERSIST_SLOTS + 31) / 32] = { 0 };
+  uint8_t key[SHA256_DIGEST_SZ];
+  int best_slot = 0, last_slot = -1;
+
+  hmac_sha256(sed_secret, sizeof(sed_secret), PERSIST_LABEL, sizeof(PERSIST_LABEL) - 1, key);
+  hmac_sha256_key(&persist_key, key, sizeof(key));
+  memset(key, 0, sizeof(key));
+  flash_setup();
+
+  // a torn record can still look plausible, so the next record numbers past
+  // every plausible one rather than only past the newest intact one. The
+  // epoch likewise moves past every one recorded, even if none is intact
+  next_seq = 0;
+  st->registered = 0;
+  st->epoch = 0;
+  for (int slot = 0; slot < PERSIST_SLOTS; slot++) {
+    rec = slot_rec(slot);
+    if (!rec_plausible(rec)) {
+      continue;
+    }
+    if (last_slot < 0 || rec->seq + 1 >= next_seq) {
+      next_seq = rec->seq + 1;
+      last_slot = slot;
+    }
+    if (rec->epoch > st->epoch) {
+      st->epoch = rec->epoch;
+    }
+  }
+  next_slot = (last_slot + 1) % PERSIST_SLOTS;
+
+  // only the newest plausible record normally needs its tag checked; fall
+  // back slot by slot while the newest fail, so that a record sharing its
+  // sequence number with a torn one is still found
+  do {
+    best = NULL;
+    for (int slot = 0; slot < PERSIST_SLOTS; slot++) {
+      rec = slot_rec(slot);
+      if (rec_plausible(rec) && !(rejected[slot / 32] & (1u << slot % 32)) &&
+          (!best || rec->seq > best->seq)) {
+        best = rec;
+        best_slot = slot;
+      }
+    }
+    if (best && rec_authentic(best)) {
+      break;
+    }
+    rejected[best_slot / 32] |= 1u << best_slot % 32;
+  } while (best);
+
+  if (!best) {
+    return 0;
+  }
+
+  st->registered = best->registered;
+  return 1;
+}
+
+
+void persist_save(const persist_state_t *st) {
+  persist_rec_t rec;
+
+  memset(&rec, 0, sizeof(rec));
+  rec.magic = PERSIST_MAGIC;
+  rec.seq = next_seq++;
+  rec.id = SCEWL_ID;
+  rec.registered = st->registered;
+  rec.epoch = st->epoch;
+  rec_tag(&rec, rec.tag);
+
+  flash_setup();
+
+  // skip slots left dirty by a torn write, erasing each page as the log
+  // moves onto it
+  for (int i = 0; i < PERSIST_SLOTS; i++) {
+    if (next_slot % (FLASH_PAGE_SZ / PERSIST_REC_SZ) == 0) {
+      flash_erase(next_slot * PERSIST_REC_SZ);
+    }
+    if (slot_erased(next_slot)) {
+      break;
+    }
+    next_slot = (next_slot + 1) % PERSIST_SLOTS;
+  }
+
+  flash_write(next_slot * PERSIST_REC_SZ, (const uint32_t *)&rec, PERSIST_REC_SZ / 4);
+  next_slot = (next_slot + 1) % PERSIST_SLOTS;
+}
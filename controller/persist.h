@@ -0,0 +1,66 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller warm-start log header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include "interface.h"
+
+#include <stdint.h>
+
+// flash reserved for the log, at the top of flash and kept out of the FLASH
+// region in lm3s/controller.ld
+#define PERSIST_BASE   0x0003f000
+#define PERSIST_PAGES  4
+#define FLASH_PAGE_SZ  1024
+
+// bytes of each log record, including the magic and tag
+#define PERSIST_REC_SZ 32
+#define PERSIST_SLOTS  (PERSIST_PAGES * FLASH_PAGE_SZ / PERSIST_REC_SZ)
+
+// state a restarted controller resumes from
+typedef struct persist_state_t {
+  uint16_t registered;  // 1 if registered with the SSS
+  uint32_t epoch;       // last boot epoch used for outgoing messages
+} persist_state_t;
+
+
+/*
+ * persist_load
+ *
+ * Finds the newest intact record written by this SED with this build's
+ * secrets. Must be called once before persist_save
+ *
+ * Args:
+ *   st - pointer to the state to fill in. The epoch is the highest in any
+ *        record from this SED, intact or not, and 0 only if there is none
+ *
+ * Returns:
+ *   1 if a record was found, 0 if the log is empty, torn or stale, in which
+ *   case the controller has to register from scratch
+ */
+int persist_load(persist_state_t *st);
+
+
+/*
+ * persist_save
+ *
+ * Appends a record to the log. Records are written round-robin over the
+ * reserved pages, erasing a page only when the log moves onto it, so every
+ * page wears at the same rate and the previous record survives a reset
+ * during the write
+ *
+ * Args:
+ *   st - pointer to the state to record
+ */
+void persist_save(const persist_state_t *st);
+
+#endif // PERSIST_H
@@ -0,0 +1,228 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller cooperative scheduler
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "sched.h"
+#include "fmt.h"
+
+#include <string.h>
+
+#define INTF_EVENTS (SCHED_EV_CPU | SCHED_EV_SSS | SCHED_EV_RAD)
+
+static task_t *tasks[SCHED_MAX_TASKS];
+static int n_tasks;
+static int live;
+
+// run queue, oldest first
+static task_t *run_head, *run_tail;
+
+// edge events posted since the last pass over the waiting tasks
+static uint32_t signals;
+
+// accounting since sched_init, in 64 bits since clock_cycles wraps every
+// minute and a half at 50 MHz
+static uint32_t last_cycles;
+static uint64_t total_cycles, idle_cycles;
+
+
+void sched_init(void) {
+  n_tasks = 0;
+  live = 0;
+  run_head = run_tail = NULL;
+  signals = 0;
+  total_cycles = idle_cycles = 0;
+
+  clock_period(SCHED_TICK_US);
+  last_cycles = clock_cycles();
+}
+
+
+// bring total_cycles up to date, at least once per SysTick period
+static void count_total(void) {
+  uint32_t now = clock_cycles();
+
+  total_cycles += now - last_cycles;
+  last_cycles = now;
+}
+
+
+static void enqueue(task_t *t) {
+  t->state = TASK_READY;
+  t->next = NULL;
+  if (run_tail) {
+    run_tail->next = t;
+  } else {
+    run_head = t;
+  }
+  run_tail = t;
+}
+
+
+void sched_add(task_t *t, const char *name, task_fn_t fn) {
+  if (n_tasks == SCHED_MAX_TASKS) {
+    return;
+  }
+
+  memset(t, 0, sizeof(task_t));
+  t->name = name;
+  t->fn = fn;
+  tasks[n_tasks++] = t;
+  live++;
+  enqueue(t);
+}
+
+
+void sched_signal(uint32_t events) {
+  signals |= events;
+}
+
+
+// events that are currently true, apart from timers
+static uint32_t events_now(void) {
+  uint32_t ev = signals;
+
+  signals = 0;
+  if (intf_avail(CPU_INTF)) {
+    ev |= SCHED_EV_CPU;
+  }
+  if (intf_avail(SSS_INTF)) {
+    ev |= SCHED_EV_SSS;
+  }
+  if (intf_avail(RAD_INTF)) {
+    ev |= SCHED_EV_RAD;
+  }
+  return ev;
+}
+
+
+// make the waiting tasks that one of the events applies to ready, and
+// return the events the rest are waiting on
+static uint32_t wake_tasks(uint32_t ev) {
+  uint32_t waiting = 0, now = clock_cycles();
+  task_t *t;
+
+  for (int i = 0; i < n_tasks; i++) {
+    t = tasks[i];
+    if (t->state != TASK_WAITING) {
+      continue;
+    }
+
+    if ((t->wait & ev) ||
+        ((t->wait & SCHED_EV_TIMER) && (int32_t)(now - t->wake) >= 0)) {
+      enqueue(t);
+    } else {
+      waiting |= t->wait;
+    }
+  }
+  return waiting;
+}
+
+
+// sleep until an interface a task waits on has data, or the next SysTick
+static void idle_sleep(uint32_t waiting) {
+  intf_t *intfs[3];
+  int n = 0;
+  uint32_t start = clock_cycles();
+
+  if (waiting & SCHED_EV_CPU) {
+    intfs[n++] = CPU_INTF;
+  }
+  if (waiting & SCHED_EV_SSS) {
+    intfs[n++] = SSS_INTF;
+  }
+  if (waiting & SCHED_EV_RAD) {
+    intfs[n++] = RAD_INTF;
+  }
+
+  intf_wait(intfs, n);
+  idle_cycles += clock_cycles() - start;
+}
+
+
+HOT void sched_run(void) {
+  uint32_t waiting, start;
+  int idled = 0;
+  task_t *t;
+
+  while (live) {
+    count_total();
+    waiting = wake_tasks(events_now());
+
+    if (!run_head) {
+      // give background work one chance before going to sleep
+      if (!idled) {
+        idled = 1;
+        wake_tasks(SCHED_EV_IDLE);
+        continue;
+      }
+
+      idle_sleep(waiting & INTF_EVENTS);
+      idled = 0;
+      continue;
+    }
+
+    t = run_head;
+    run_head = t->next;
+    if (!run_head) {
+      run_tail = NULL;
+    }
+
+    start = clock_cycles();
+    t->state = t->fn(t);
+    t->cycles += clock_cycles() - start;
+    t->runs++;
+
+    if (t->state == TASK_READY) {
+      enqueue(t);
+    } else if (t->state == TASK_DONE) {
+      live--;
+    }
+  }
+}
+
+
+static uint32_t to_us(uint64_t cycles) {
+  return cycles * 1000000 / clock_hz();
+}
+
+
+// append " name value"
+static int put_field(char *out, const char *name, uint32_t value) {
+  int n = strlen(name);
+
+  out[0] = ' ';
+  memcpy(out + 1, name, n);
+  out[n + 1] = ' ';
+  return n + 2 + fmt_num(out + n + 2, value);
+}
+
+
+int sched_report(char *out) {
+  uint64_t busy = idle_cycles;
+  int n = 0;
+
+  count_total();
+  for (int i = 0; i < n_tasks; i++) {
+    busy += tasks[i]->cycles;
+  }
+
+  memcpy(out, "sched us:", 9);
+  n += 9;
+  n += put_field(out + n, "total", to_us(total_cycles));
+  n += put_field(out + n, "idle", to_us(idle_cycles));
+  n += put_field(out + n, "sched", busy < total_cycles ? to_us(total_cycles - busy) : 0);
+  for (int i = 0; i < n_tasks; i++) {
+    n += put_field(out + n, tasks[i]->name, to_us(tasks[i]->cycles));
+    out[n++] = '/';
+    n += fmt_num(out + n, tasks[i]->runs);
+  }
+
+  return n;
+}
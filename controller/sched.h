@@ -0,0 +1,165 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller cooperative scheduler header
+ *
+ * Tasks are stackless protothreads: a task is a function that is called
+ * again from the top every time it is scheduled and jumps back to where it
+ * left off through a switch on its line counter. Locals do not survive a
+ * wait, so tasks keep their state in statics or in the task_t they are
+ * embedded in. Only one task runs at a time and only gives up the core at
+ * TASK_YIELD, TASK_WAIT and TASK_SLEEP
+ *
+ * Interface events only say that a frame has started to arrive. The
+ * controller's tasks then read the whole frame with a blocking read_msg, so
+ * tasks switch at frame boundaries only: a sender that stalls part way
+ * through a frame holds up every other task until the rest of it arrives
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "interface.h"
+#include "clock.h"
+
+#include <stdint.h>
+
+// most tasks the scheduler tracks
+#define SCHED_MAX_TASKS 8
+
+// SysTick period while the scheduler runs, which is the resolution of
+// TASK_SLEEP. Interfaces wake the core on their own interrupts
+#define SCHED_TICK_US 10000
+
+// bytes sched_report writes at most, with task names of up to 16 characters
+#define SCHED_REPORT_SZ (64 + SCHED_MAX_TASKS * 40)
+
+// events a waiting task can be made ready by. The interface events are
+// levels (data waiting in the receive FIFO), the rest are edges
+enum sched_event {
+  SCHED_EV_CPU   = 0x01,  // CPU_INTF has data
+  SCHED_EV_SSS   = 0x02,  // SSS_INTF has data
+  SCHED_EV_RAD   = 0x04,  // RAD_INTF has data
+  SCHED_EV_TIMER = 0x08,  // the task's TASK_SLEEP deadline passed
+  SCHED_EV_IDLE  = 0x10,  // nothing is ready, once before each sleep
+  SCHED_EV_USER  = 0x100, // first bit free for sched_signal
+};
+
+// values returned by task functions
+enum task_state { TASK_READY, TASK_WAITING, TASK_DONE };
+
+typedef struct task_t task_t;
+typedef int (*task_fn_t)(task_t *t);
+
+struct task_t {
+  const char *name;
+  task_fn_t fn;
+  uint16_t lc;      // line to resume at, 0 to start from the top
+  uint16_t state;   // task_state after the last run
+  uint32_t wait;    // sched_events that make a waiting task ready
+  uint32_t wake;    // clock_cycles deadline of SCHED_EV_TIMER
+  uint64_t cycles;  // core cycles spent running the task
+  uint32_t runs;    // times the task was run
+  task_t *next;     // run queue link
+};
+
+// protothread primitives, usable only in the body of a task function
+#define TASK_BEGIN(t) switch ((t)->lc) { case 0:
+
+#define TASK_END(t) } (t)->lc = 0; return TASK_DONE
+
+// let the other ready tasks run first
+#define TASK_YIELD(t) \
+  do { (t)->lc = __LINE__; return TASK_READY; case __LINE__:; } while (0)
+
+// wait until cond holds, checking it again whenever one of events happens
+#define TASK_WAIT(t, events, cond) \
+  do { \
+    (t)->lc = __LINE__; case __LINE__: \
+    if (!(cond)) { (t)->wait = (events); return TASK_WAITING; } \
+  } while (0)
+
+// wait for the next time one of events happens
+#define TASK_WAIT_EVENT(t, events) \
+  do { \
+    (t)->wait = (events); (t)->lc = __LINE__; return TASK_WAITING; \
+    case __LINE__:; \
+  } while (0)
+
+// wait at least us microseconds, give or take a SysTick period
+#define TASK_SLEEP(t, us) \
+  do { \
+    (t)->wake = clock_cycles() + clock_ticks(us); \
+    TASK_WAIT(t, SCHED_EV_TIMER, (int32_t)(clock_cycles() - (t)->wake) >= 0); \
+  } while (0)
+
+
+/*
+ * sched_init
+ *
+ * Forgets all tasks and statistics and sets the SysTick period to
+ * SCHED_TICK_US, keeping clock_cycles counting
+ */
+void sched_init(void);
+
+
+/*
+ * sched_add
+ *
+ * Adds a task, ready to run from the top
+ *
+ * Args:
+ *   t - task to add, which must stay valid while the scheduler runs
+ *   name - name used in sched_report
+ *   fn - task function
+ */
+void sched_add(task_t *t, const char *name, task_fn_t fn);
+
+
+/*
+ * sched_signal
+ *
+ * Posts edge events, making every task waiting on one of them ready. Events
+ * nobody is waiting on are dropped, so tasks check the state the event
+ * stands for in their TASK_WAIT condition
+ *
+ * Args:
+ *   events - SCHED_EV_USER or higher bits
+ */
+void sched_signal(uint32_t events);
+
+
+/*
+ * sched_run
+ *
+ * Runs the ready tasks round robin, sleeping with WFI while none are ready
+ * and the receive interrupts of the interfaces waited on armed
+ *
+ * Returns:
+ *   once every task has finished
+ */
+void sched_run(void);
+
+
+/*
+ * sched_report
+ *
+ * Formats the CPU time accounting since sched_init as one line of text, e.g.
+ * "sched us: total 10000000 idle 9940000 sched 2000 cpu 40000/12 ..."
+ * where sched is the time spent switching between tasks and each task gets
+ * the time it ran for and the number of runs
+ *
+ * Args:
+ *   out - buffer of at least SCHED_REPORT_SZ bytes
+ *
+ * Returns:
+ *   length of the text, which is not NUL terminated
+ */
+int sched_report(char *out);
+
+#endif // SCHED_H
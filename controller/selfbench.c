@@ -0,0 +1,199 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller self-benchmark
+ *
+ * Built into the controller with BENCH (see the Makefile). Unlike the
+ * standalone images in bench/, this runs inside a deployment, so the
+ * numbers include the real interfaces and radio
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "selfbench.h"
+#include "clock.h"
+#include "sha256.h"
+#include "auth.h"
+#include "stack.h"
+#include "fmt.h"
+
+// frames per framing measurement and per round trip measurement. Every byte
+// read costs intf_read's delay loop, so these are kept small
+#define SB_FRAMES 2
+#define SB_PINGS  4
+
+// body size of the HMAC and message signing measurements
+#define SB_MSG_SZ 64
+
+// how long to wait for the radio to echo a frame back
+#define SB_TIMEOUT_US 1000000
+
+// body sizes of the framing measurements
+static const struct {
+  uint16_t len;
+  char *send_name, *read_name;
+} frame_sizes[] = {
+  { 16,  "send_msg 16B",  "read_msg 16B" },
+  { 64,  "send_msg 64B",  "read_msg 64B" },
+  { 256, "send_msg 256B", "read_msg 256B" },
+};
+
+
+// send "bench name: value unit" to the FAA transceiver
+static void report(char *name, uint32_t value, char *unit) {
+  char line[64];
+  int n = 0;
+
+  memcpy(line, "bench ", 6);
+  n += 6;
+  memcpy(line + n, name, strlen(name));
+  n += strlen(name);
+  line[n++] = ':';
+  line[n++] = ' ';
+  n += fmt_num(line + n, value);
+  line[n++] = ' ';
+  memcpy(line + n, unit, strlen(unit));
+  n += strlen(unit);
+
+  send_msg(RAD_INTF, SCEWL_ID, SCEWL_FAA_ID, n, line);
+}
+
+
+// read the next frame this SED sent itself, discarding other radio traffic
+// read meanwhile. Returns the cycles read_msg took, or 0 if nothing came back
+// within SB_TIMEOUT_US of the call, however busy the radio is
+static uint32_t read_echo(char *data, uint16_t len) {
+  scewl_id_t src_id, tgt_id;
+  uint32_t deadline = clock_cycles() + clock_ticks(SB_TIMEOUT_US), start;
+
+  while ((int32_t)(clock_cycles() - deadline) < 0) {
+    if (!intf_avail(RAD_INTF)) {
+      continue;
+    }
+
+    start = clock_cycles();
+    read_msg(RAD_INTF, data, &src_id, &tgt_id, len, 1);
+    if (src_id == SCEWL_ID && tgt_id == SCEWL_ID) {
+      return clock_cycles() - start;
+    }
+  }
+  return 0;
+}
+
+
+// cycles per byte spent framing messages in send_msg and read_msg
+static void bench_framing(char *scratch) {
+  uint32_t start, sent, read, took;
+  uint16_t len;
+
+  for (int i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+    len = frame_sizes[i].len;
+    sent = read = 0;
+
+    for (int j = 0; j < SB_FRAMES; j++) {
+      start = clock_cycles();
+      send_msg(RAD_INTF, SCEWL_ID, SCEWL_ID, len, scratch);
+      sent += clock_cycles() - start;
+
+      took = read_echo(scratch + SELFBENCH_BLOCK, len);
+      if (!took) {
+        report("framing", 0, "timeout");
+        return;
+      }
+      read += took;
+    }
+
+    report(frame_sizes[i].send_name, sent / (SB_FRAMES * (sizeof(scewl_hdr_t) + len)),
+           "cycles/byte");
+    report(frame_sizes[i].read_name, read / (SB_FRAMES * (sizeof(scewl_hdr_t) + len)),
+           "cycles/byte");
+  }
+}
+
+
+// time from sending a one byte frame to having read it back
+static void bench_round_trip(char *scratch) {
+  uint32_t start, total = 0;
+
+  for (int i = 0; i < SB_PINGS; i++) {
+    start = clock_cycles();
+    send_msg(RAD_INTF, SCEWL_ID, SCEWL_ID, 1, scratch);
+    if (!read_echo(scratch + SELFBENCH_BLOCK, 1)) {
+      report("radio round trip", 0, "timeout");
+      return;
+    }
+    total += clock_cycles() - start;
+  }
+
+  report("radio round trip", (uint64_t)total * 1000000 / clock_hz() / SB_PINGS, "us");
+}
+
+
+static void bench_crypto(char *scratch) {
+  uint8_t digest[SHA256_DIGEST_SZ], mac[SHA256_DIGEST_SZ], tag[AUTH_TAG_SZ];
+  scewl_hdr_t hdr = { 'S', 'C', SCEWL_BRDCST_ID, SCEWL_ID, 0 };
+  scewl_sec_hdr_t sec = { 1, 1 };
+  uint32_t start, end;
+
+  start = clock_cycles();
+  sha256(scratch, SELFBENCH_BLOCK, digest);
+  end = clock_cycles();
+  report("sha256", (end - start) / SELFBENCH_BLOCK, "cycles/byte");
+
+  start = clock_cycles();
+  for (int i = 0; i < SELFBENCH_BLOCK / SB_MSG_SZ; i++) {
+    hmac_sha256(digest, sizeof(digest), scratch + i * SB_MSG_SZ, SB_MSG_SZ, mac);
+  }
+  end = clock_cycles();
+  report("hmac_sha256 64B", (end - start) / SELFBENCH_BLOCK, "cycles/byte");
+
+  hdr.len = sizeof(sec) + SB_MSG_SZ + AUTH_TAG_SZ;
+  start = clock_cycles();
+  for (int i = 0; i < SELFBENCH_BLOCK / SB_MSG_SZ; i++) {
+    auth_sign(&hdr, &sec, scratch + i * SB_MSG_SZ, SB_MSG_SZ, tag);
+  }
+  end = clock_cycles();
+  report("auth_sign 64B", (end - start) / SELFBENCH_BLOCK, "cycles/byte");
+}
+
+
+// bytes per second moved by memcpy and memset
+static void bench_memory(char *scratch) {
+  uint32_t start, end;
+
+  start = clock_cycles();
+  for (int i = 0; i < 8; i++) {
+    memcpy(scratch + SELFBENCH_BLOCK, scratch, SELFBENCH_BLOCK);
+  }
+  end = clock_cycles();
+  report("memcpy", (uint64_t)8 * SELFBENCH_BLOCK * clock_hz() / (end - start) / 1024, "KB/s");
+
+  start = clock_cycles();
+  for (int i = 0; i < 8; i++) {
+    memset(scratch, i, SELFBENCH_BLOCK);
+  }
+  end = clock_cycles();
+  report("memset", (uint64_t)8 * SELFBENCH_BLOCK * clock_hz() / (end - start) / 1024, "KB/s");
+}
+
+
+void selfbench_run(char *scratch) {
+  uint32_t start = clock_cycles();
+
+  memset(scratch, 'A', SELFBENCH_SCRATCH_SZ);
+  report("clock", clock_hz() / 1000000, "MHz");
+
+  bench_memory(scratch);
+  bench_crypto(scratch);
+  bench_framing(scratch);
+  bench_round_trip(scratch);
+
+  // deepest the stack has been since reset, which includes the suite above
+  report("stack used", stack_used(), "bytes");
+  report("stack size", stack_size(), "bytes");
+
+  report("suite", (uint64_t)(clock_cycles() - start) * 1000 / clock_hz(), "ms");
+}
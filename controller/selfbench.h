@@ -0,0 +1,40 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller self-benchmark header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef SELFBENCH_H
+#define SELFBENCH_H
+
+#include "controller.h"
+
+// bytes hashed, copied and set per measurement
+#define SELFBENCH_BLOCK 4096
+
+// bytes of scratch space selfbench_run needs
+#define SELFBENCH_SCRATCH_SZ (2 * SELFBENCH_BLOCK)
+
+
+/*
+ * selfbench_run
+ *
+ * Runs the benchmark suite, sending each result to the FAA transceiver as
+ * one message of the form "bench name: value unit". Frames to this SED are
+ * echoed back by the radio, which the framing and round trip measurements
+ * rely on, so they report a timeout if no radio is attached. Other radio
+ * frames that arrive while they wait for an echo are read and dropped, so
+ * BENCH builds lose any traffic sent to them during the suite. Must be called
+ * after auth_init, before registering
+ *
+ * Args:
+ *   scratch - buffer of at least SELFBENCH_SCRATCH_SZ bytes to overwrite
+ */
+void selfbench_run(char *scratch);
+
+#endif // SELFBENCH_H
@@ -0,0 +1,265 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller SHA-256 and HMAC-SHA-256 implementation
+ *
+ * The compression function is written for Thumb-2: all 64 rounds are unrolled
+ * so the working variables rotate by renaming instead of moving, the message
+ * schedule is expanded in place in a 16-word ring with constant indices, the
+ * rotates fold into the shifted-operand forms of EOR/ADD, and words are
+ * byte-swapped with REV
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "sha256.h"
+
+#include <string.h>
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define S0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define S1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define s0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define s1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+// message word i of the current block, big endian
+#define LOAD(i) (memcpy(&w[i], p + 4 * (i), 4), w[i] = __builtin_bswap32(w[i]))
+
+// expand schedule word j in place; j & 15 is a constant once unrolled
+#define EXPAND(j) (w[(j) & 15] += s1(w[((j) - 2) & 15]) + w[((j) - 7) & 15] + \
+                                  s0(w[((j) - 15) & 15]))
+
+// one round; callers rotate the argument names instead of the values
+#define R(a, b, c, d, e, f, g, h, j, wj)                    \
+  t = h + S1(e) + CH(e, f, g) + k[j] + (wj);                \
+  d += t;                                                   \
+  h = t + S0(a) + MAJ(a, b, c);
+
+// eight rounds starting at round j
+#define R8(j, W)                                            \
+  R(a, b, c, d, e, f, g, h, (j) + 0, W((j) + 0))            \
+  R(h, a, b, c, d, e, f, g, (j) + 1, W((j) + 1))            \
+  R(g, h, a, b, c, d, e, f, (j) + 2, W((j) + 2))            \
+  R(f, g, h, a, b, c, d, e, (j) + 3, W((j) + 3))            \
+  R(e, f, g, h, a, b, c, d, (j) + 4, W((j) + 4))            \
+  R(d, e, f, g, h, a, b, c, (j) + 5, W((j) + 5))            \
+  R(c, d, e, f, g, h, a, b, (j) + 6, W((j) + 6))            \
+  R(b, c, d, e, f, g, h, a, (j) + 7, W((j) + 7))
+
+#define W_LOAD(j) LOAD(j)
+#define W_EXPAND(j) EXPAND(j)
+
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+
+// compress n consecutive blocks into the state
+HOT static void sha256_blocks(uint32_t *state, const uint8_t *p, size_t n) {
+  uint32_t a, b, c, d, e, f, g, h, t;
+  uint32_t w[16];
+
+  while (n--) {
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+    R8(0,  W_LOAD)
+    R8(8,  W_LOAD)
+    R8(16, W_EXPAND)
+    R8(24, W_EXPAND)
+    R8(32, W_EXPAND)
+    R8(40, W_EXPAND)
+    R8(48, W_EXPAND)
+    R8(56, W_EXPAND)
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+    p += SHA256_BLOCK_SZ;
+  }
+}
+
+
+void sha256_init(sha256_ctx_t *ctx) {
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->len_lo = 0;
+  ctx->len_hi = 0;
+  ctx->buf_len = 0;
+}
+
+
+HOT void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  size_t n;
+
+  // track the total length as a 64-bit count
+  ctx->len_lo += len;
+  if (ctx->len_lo < len) {
+    ctx->len_hi++;
+  }
+
+  // top up a partial block first
+  if (ctx->buf_len) {
+    n = SHA256_BLOCK_SZ - ctx->buf_len;
+    n = len < n ? len : n;
+    memcpy(ctx->buf + ctx->buf_len, p, n);
+    ctx->buf_len += n;
+    p += n;
+    len -= n;
+
+    if (ctx->buf_len < SHA256_BLOCK_SZ) {
+      return;
+    }
+    sha256_blocks(ctx->state, ctx->buf, 1);
+    ctx->buf_len = 0;
+  }
+
+  // hash whole blocks straight from the input
+  n = len / SHA256_BLOCK_SZ;
+  if (n) {
+    sha256_blocks(ctx->state, p, n);
+    p += n * SHA256_BLOCK_SZ;
+    len -= n * SHA256_BLOCK_SZ;
+  }
+
+  // keep the tail
+  memcpy(ctx->buf, p, len);
+  ctx->buf_len = len;
+}
+
+
+HOT void sha256_final(sha256_ctx_t *ctx, uint8_t *digest) {
+  uint32_t bits_hi = (ctx->len_hi << 3) | (ctx->len_lo >> 29);
+  uint32_t bits_lo = ctx->len_lo << 3;
+  uint32_t word;
+
+  // pad with 0x80, zeros, then the 64-bit big-endian bit length
+  ctx->buf[ctx->buf_len++] = 0x80;
+  if (ctx->buf_len > SHA256_BLOCK_SZ - 8) {
+    memset(ctx->buf + ctx->buf_len, 0, SHA256_BLOCK_SZ - ctx->buf_len);
+    sha256_blocks(ctx->state, ctx->buf, 1);
+    ctx->buf_len = 0;
+  }
+  memset(ctx->buf + ctx->buf_len, 0, SHA256_BLOCK_SZ - 8 - ctx->buf_len);
+  word = __builtin_bswap32(bits_hi);
+  memcpy(ctx->buf + SHA256_BLOCK_SZ - 8, &word, 4);
+  word = __builtin_bswap32(bits_lo);
+  memcpy(ctx->buf + SHA256_BLOCK_SZ - 4, &word, 4);
+  sha256_blocks(ctx->state, ctx->buf, 1);
+
+  for (int i = 0; i < 8; i++) {
+    word = __builtin_bswap32(ctx->state[i]);
+    memcpy(digest + 4 * i, &word, 4);
+  }
+
+  // don't leave message or state behind
+  memset(ctx, 0, sizeof(sha256_ctx_t));
+}
+
+
+void sha256(const void *data, size_t len, uint8_t *digest) {
+  sha256_ctx_t ctx;
+
+  sha256_init(&ctx);
+  sha256_update(&ctx, data, len);
+  sha256_final(&ctx, digest);
+}
+
+
+void hmac_sha256_init(hmac_sha256_ctx_t *ctx, const void *key, size_t key_len) {
+  uint8_t pad[SHA256_BLOCK_SZ];
+  int i;
+
+  // keys longer than a block are hashed first
+  memset(pad, 0, sizeof(pad));
+  if (key_len > SHA256_BLOCK_SZ) {
+    sha256(key, key_len, pad);
+  } else {
+    memcpy(pad, key, key_len);
+  }
+
+  // absorb key ^ ipad and key ^ opad once; every message reuses these states
+  for (i = 0; i < SHA256_BLOCK_SZ; i++) {
+    pad[i] ^= 0x36;
+  }
+  sha256_init(&ctx->inner);
+  sha256_update(&ctx->inner, pad, sizeof(pad));
+
+  for (i = 0; i < SHA256_BLOCK_SZ; i++) {
+    pad[i] ^= 0x36 ^ 0x5c;
+  }
+  sha256_init(&ctx->outer);
+  sha256_update(&ctx->outer, pad, sizeof(pad));
+
+  memset(pad, 0, sizeof(pad));
+}
+
+
+void hmac_sha256_key(hmac_sha256_key_t *k, const void *key, size_t key_len) {
+  hmac_sha256_ctx_t ctx;
+
+  hmac_sha256_init(&ctx, key, key_len);
+  memcpy(k->inner, ctx.inner.state, sizeof(k->inner));
+  memcpy(k->outer, ctx.outer.state, sizeof(k->outer));
+  memset(&ctx, 0, sizeof(ctx));
+}
+
+
+// resume a hash that has absorbed exactly one block
+static void sha256_resume(sha256_ctx_t *ctx, const uint32_t *state) {
+  memcpy(ctx->state, state, sizeof(ctx->state));
+  ctx->len_lo = SHA256_BLOCK_SZ;
+  ctx->len_hi = 0;
+  ctx->buf_len = 0;
+}
+
+
+HOT void hmac_sha256_init_key(hmac_sha256_ctx_t *ctx, const hmac_sha256_key_t *k) {
+  sha256_resume(&ctx->inner, k->inner);
+  sha256_resume(&ctx->outer, k->outer);
+}
+
+
+HOT void hmac_sha256_update(hmac_sha256_ctx_t *ctx, const void *data, size_t len) {
+  sha256_update(&ctx->inner, data, len);
+}
+
+
+HOT void hmac_sha256_final(hmac_sha256_ctx_t *ctx, uint8_t *mac) {
+  uint8_t inner[SHA256_DIGEST_SZ];
+
+  sha256_final(&ctx->inner, inner);
+  sha256_update(&ctx->outer, inner, sizeof(inner));
+  sha256_final(&ctx->outer, mac);
+  memset(inner, 0, sizeof(inner));
+}
+
+
+void hmac_sha256(const void *key, size_t key_len, const void *data, size_t len,
+                 uint8_t *mac) {
+  hmac_sha256_ctx_t ctx;
+
+  hmac_sha256_init(&ctx, key, key_len);
+  hmac_sha256_update(&ctx, data, len);
+  hmac_sha256_final(&ctx, mac);
+}
@@ -0,0 +1,173 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller SHA-256 and HMAC-SHA-256 header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include "interface.h"
+
+#include <stdint.h>
+
+#define SHA256_BLOCK_SZ  64
+#define SHA256_DIGEST_SZ 32
+
+// streaming SHA-256 state
+typedef struct sha256_ctx_t {
+  uint32_t state[8];
+  uint32_t len_lo;  // bytes hashed so far
+  uint32_t len_hi;
+  uint32_t buf_len;
+  uint8_t  buf[SHA256_BLOCK_SZ];
+} sha256_ctx_t;
+
+// HMAC key reduced to the chaining values after the ipad and opad blocks,
+// the compact form to cache a key in
+typedef struct hmac_sha256_key_t {
+  uint32_t inner[8];
+  uint32_t outer[8];
+} hmac_sha256_key_t;
+
+// streaming HMAC-SHA-256 state. A context that has only been through
+// hmac_sha256_init can be copied to reuse the key without rehashing it
+typedef struct hmac_sha256_ctx_t {
+  sha256_ctx_t inner;
+  sha256_ctx_t outer;
+} hmac_sha256_ctx_t;
+
+
+/*
+ * sha256_init
+ *
+ * Starts a new hash
+ *
+ * Args:
+ *   ctx - pointer to the context
+ */
+void sha256_init(sha256_ctx_t *ctx);
+
+
+/*
+ * sha256_update
+ *
+ * Adds data to a hash. May be called any number of times
+ *
+ * Args:
+ *   ctx - pointer to the context
+ *   data - pointer to the data
+ *   len - length of the data in bytes
+ */
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+
+
+/*
+ * sha256_final
+ *
+ * Finishes a hash
+ *
+ * Args:
+ *   ctx - pointer to the context
+ *   digest - buffer of SHA256_DIGEST_SZ bytes to write the digest to
+ */
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest);
+
+
+/*
+ * sha256
+ *
+ * Hashes a buffer in one call
+ *
+ * Args:
+ *   data - pointer to the data
+ *   len - length of the data in bytes
+ *   digest - buffer of SHA256_DIGEST_SZ bytes to write the digest to
+ */
+void sha256(const void *data, size_t len, uint8_t *digest);
+
+
+/*
+ * hmac_sha256_init
+ *
+ * Starts a new MAC
+ *
+ * Args:
+ *   ctx - pointer to the context
+ *   key - pointer to the key
+ *   key_len - length of the key in bytes
+ */
+void hmac_sha256_init(hmac_sha256_ctx_t *ctx, const void *key, size_t key_len);
+
+
+/*
+ * hmac_sha256_key
+ *
+ * Precomputes the compact form of a key
+ *
+ * Args:
+ *   k - pointer to the precomputed key to fill
+ *   key - pointer to the key
+ *   key_len - length of the key in bytes
+ */
+void hmac_sha256_key(hmac_sha256_key_t *k, const void *key, size_t key_len);
+
+
+/*
+ * hmac_sha256_init_key
+ *
+ * Starts a new MAC from a precomputed key without hashing the key again
+ *
+ * Args:
+ *   ctx - pointer to the context
+ *   k - pointer to the precomputed key
+ */
+void hmac_sha256_init_key(hmac_sha256_ctx_t *ctx, const hmac_sha256_key_t *k);
+
+
+/*
+ * hmac_sha256_update
+ *
+ * Adds data to a MAC. May be called any number of times
+ *
+ * Args:
+ *   ctx - pointer to the context
+ *   data - pointer to the data
+ *   len - length of the data in bytes
+ */
+void hmac_sha256_update(hmac_sha256_ctx_t *ctx, const void *data, size_t len);
+
+
+/*
+ * hmac_sha256_final
+ *
+ * Finishes a MAC
+ *
+ * Args:
+ *   ctx - pointer to the context
+ *   mac - buffer of SHA256_DIGEST_SZ bytes to write the MAC to
+ */
+void hmac_sha256_final(hmac_sha256_ctx_t *ctx, uint8_t *mac);
+
+
+/*
+ * hmac_sha256
+ *
+ * Computes a MAC over a buffer in one call
+ *
+ * Args:
+ *   key - pointer to the key
+ *   key_len - length of the key in bytes
+ *   data - pointer to the data
+ *   len - length of the data in bytes
+ *   mac - buffer of SHA256_DIGEST_SZ bytes to write the MAC to
+ */
+void hmac_sha256(const void *key, size_t key_len, const void *data, size_t len,
+                 uint8_t *mac);
+
+#endif // SHA256_H
@@ -0,0 +1,33 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller stack watermark
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "stack.h"
+
+// ends of the stack, from lm3s/controller.ld
+extern uint32_t _stack_bottom;
+extern uint32_t _stack_top;
+
+
+uint32_t stack_size(void) {
+  return (uint32_t)&_stack_top - (uint32_t)&_stack_bottom;
+}
+
+
+uint32_t stack_used(void) {
+  const uint32_t *p = &_stack_bottom;
+
+  // the stack grows down, so scan up from the bottom to the first used word
+  while (p < &_stack_top && *p == STACK_PAINT) {
+    p++;
+  }
+
+  return (uint32_t)&_stack_top - (uint32_t)p;
+}
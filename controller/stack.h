@@ -0,0 +1,42 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller stack watermark header
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdint.h>
+
+// word Reset_Handler paints the whole stack with before anything runs on it
+#define STACK_PAINT 0xdeadbeef
+
+
+/*
+ * stack_size
+ *
+ * Returns:
+ *   bytes reserved for the stack by the linker script (_STACK_SIZE)
+ */
+uint32_t stack_size(void);
+
+
+/*
+ * stack_used
+ *
+ * Finds the high-water mark of the stack by looking for the deepest word that
+ * no longer holds STACK_PAINT. A frame that happens to store STACK_PAINT at
+ * its deepest word reads a word short
+ *
+ * Returns:
+ *   most bytes of stack in use at once since reset
+ */
+uint32_t stack_used(void);
+
+#endif // STACK_H
@@ -0,0 +1,35 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller event trace implementation
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "trace.h"
+#include "clock.h"
+
+#include <string.h>
+
+// only linked in when TRACE is defined (see the Makefile)
+trace_log_t trace_log;
+
+
+void trace_init(void) {
+  memcpy(trace_log.magic, "TRC1", 4);
+  trace_log.hz = clock_hz();
+  trace_log.count = 0;
+}
+
+
+HOT void trace_event(uint8_t event, uint8_t dest, uint16_t len) {
+  trace_rec_t *rec = &trace_log.recs[trace_log.count++ & (TRACE_SLOTS - 1)];
+
+  rec->cycles = clock_cycles();
+  rec->event = event;
+  rec->intf = dest;
+  rec->len = len;
+}
@@ -0,0 +1,93 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Controller event trace header
+ *
+ * Builds with TRACE defined (see the Makefile) record timestamped events on
+ * the message path in a ring in SRAM. Without it TRACE_EVENT compiles to
+ * nothing. The FAA transceiver's `trace` command and tools/trace.gdb read
+ * the ring out and tools/trace_report.py turns it into a latency breakdown
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "interface.h"
+
+#include <stdint.h>
+
+// number of events kept, oldest overwritten first (must be a power of 2)
+#define TRACE_SLOTS 256
+
+// body of an FAA message asking for the trace
+#define TRACE_CMD "trace"
+
+// trace_event events
+enum trace_event {
+  TRACE_HDR,           // frame header parsed: interface it came in on, length
+  TRACE_ROUTE,         // routing decision: where the frame goes, length
+  TRACE_CRYPTO_START,  // MAC or verification started: interface, length
+  TRACE_CRYPTO_END,    // MAC or verification done, same as the start
+  TRACE_TX_QUEUED,     // frame handed to an interface: interface, length
+  TRACE_TX_DONE,       // last byte of the frame written: interface, length
+};
+
+// destinations of TRACE_ROUTE besides the interfaces
+enum trace_dest { TRACE_CPU, TRACE_SSS, TRACE_RAD, TRACE_DROP };
+
+// one event, 8 bytes
+typedef struct trace_rec_t {
+  uint32_t cycles;  // clock_cycles when the event happened
+  uint8_t  event;
+  uint8_t  intf;    // trace_dest
+  uint16_t len;
+} trace_rec_t;
+
+// the ring and what is needed to read it, laid out the same in SRAM and in
+// an FAA dump
+typedef struct trace_log_t {
+  char     magic[4];  // "TRC1"
+  uint32_t hz;        // core clock, to convert cycles to time
+  uint32_t count;     // events recorded so far; the next goes in count % TRACE_SLOTS
+  trace_rec_t recs[TRACE_SLOTS];
+} trace_log_t;
+
+#define TRACE_INTF(intf) \
+  ((intf) == CPU_INTF ? TRACE_CPU : (intf) == SSS_INTF ? TRACE_SSS : TRACE_RAD)
+
+#ifdef TRACE
+#define TRACE_EVENT(event, dest, len) trace_event(event, dest, len)
+
+extern trace_log_t trace_log;
+
+
+/*
+ * trace_init
+ *
+ * Empties the ring. Must be called after SystemInit set up the clock
+ */
+void trace_init(void);
+
+
+/*
+ * trace_event
+ *
+ * Records an event, called through TRACE_EVENT
+ *
+ * Args:
+ *   event - a trace_event
+ *   dest - a trace_dest
+ *   len - length of the frame the event is about
+ */
+void trace_event(uint8_t event, uint8_t dest, uint16_t len);
+
+#else
+#define TRACE_EVENT(event, dest, len) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,637 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL Bus Driver benchmark
+ *
+ * Runs the driver against a child process standing in for the SCEWL Bus
+ * Controller on a private Unix socket, and prints the throughput of each
+ * driver call for small and large frames. The driver's read, write, writev,
+ * fcntl and poll calls are counted by linking with --wrap (see the Makefile)
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#include "scewl_bus.h"
+
+#include <poll.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+// bytes the controller writes per write() call
+#define CHUNK_SZ 0x10000
+
+// receive buffer size, about what the example SEDs pass to scewl_recv
+#define BUF_SZ 0x4000
+
+// frame body sizes and how many frames of each to move
+static const struct {
+  uint16_t len;
+  int frames;
+} sizes[] = {
+  { 16,    200000 },
+  { 256,   100000 },
+  { 4096,  20000 },
+  { 16384, 5000 },
+};
+
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+// messages per scewl_send_batch call, each to a different target
+#define BATCH 32
+
+// non-blocking receives timed with nothing to receive
+#define EMPTY_POLLS 200000
+
+// passes over sizes[] sending frames to the driver, for scewl_recv,
+// scewl_recv_view and scewl_process_ready
+#define RECV_PASSES 3
+
+// passes over sizes[] sending frames to the controller
+#define SEND_PASSES 3
+
+// time the stand-in SSS takes to reply to a registration, and the time the
+// SED spends initializing after starting one, sending INIT_MSGS messages
+#define REG_DELAY_MS 20
+#define INIT_MS 20
+#define INIT_MSGS 8
+
+static char body[BUF_SZ];
+
+// the driver's socket, for the old two-write send
+extern int sock;
+
+// system calls made since the last report, by any thread
+static atomic_ulong syscalls;
+
+ssize_t __real_read(int fd, void *buf, size_t n);
+ssize_t __real_write(int fd, const void *buf, size_t n);
+ssize_t __real_writev(int fd, const struct iovec *iov, int cnt);
+int __real_fcntl(int fd, int cmd, ...);
+int __real_poll(struct pollfd *fds, nfds_t n, int timeout);
+
+ssize_t __wrap_read(int fd, void *buf, size_t n) {
+  syscalls++;
+  return __real_read(fd, buf, n);
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t n) {
+  syscalls++;
+  return __real_write(fd, buf, n);
+}
+
+ssize_t __wrap_writev(int fd, const struct iovec *iov, int cnt) {
+  syscalls++;
+  return __real_writev(fd, iov, cnt);
+}
+
+int __wrap_fcntl(int fd, int cmd, ...) {
+  va_list ap;
+  long arg;
+
+  va_start(ap, cmd);
+  arg = va_arg(ap, long);
+  va_end(ap);
+
+  syscalls++;
+  return __real_fcntl(fd, cmd, arg);
+}
+
+int __wrap_poll(struct pollfd *fds, nfds_t n, int timeout) {
+  syscalls++;
+  return __real_poll(fds, n, timeout);
+}
+
+
+static double now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// CPU time this process has used, in seconds
+static double cpu() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// CPU time at the start of the measurement being made
+static double cpu_start;
+
+// start a measurement, returning the time for report
+static double begin() {
+  cpu_start = cpu();
+  return now();
+}
+
+
+// report a measurement started by begin()
+static void report(char *name, uint16_t len, int frames, double start) {
+  double secs = now() - start;
+
+  printf("%-19s %5dB: %9.0f msgs/s %8.1f MB/s %6.2f syscalls/msg %7.1f ns cpu/msg\n",
+         name, len, frames / secs, frames * (double)(sizeof(scewl_hdr_t) + len) / secs / 1e6,
+         (double)syscalls / frames, (cpu() - cpu_start) * 1e9 / frames);
+  syscalls = 0;
+}
+
+
+// write n whole bytes or exit
+static void write_all(int fd, char *buf, size_t n) {
+  ssize_t written;
+
+  for (size_t done = 0; done < n; done += written) {
+    written = write(fd, buf + done, n - done);
+    if (written <= 0) {
+      perror("controller write");
+      exit(1);
+    }
+  }
+}
+
+
+// write a pass over sizes[] of frames from the FAA to the driver, packed back
+// to back into large writes like a busy controller would
+static void send_pass(int fd, char *chunk) {
+  scewl_hdr_t hdr = { 'S', 'C', SCEWL_ID, SCEWL_FAA_ID, 0 };
+  size_t used, frame_sz;
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    hdr.len = sizes[i].len;
+    frame_sz = sizeof(hdr) + hdr.len;
+    used = 0;
+
+    for (int j = 0; j < sizes[i].frames; j++) {
+      if (used + frame_sz > CHUNK_SZ) {
+        write_all(fd, chunk, used);
+        used = 0;
+      }
+      if (frame_sz > CHUNK_SZ) {
+        write_all(fd, (char *)&hdr, sizeof(hdr));
+        write_all(fd, body, hdr.len);
+        continue;
+      }
+      memcpy(chunk + used, &hdr, sizeof(hdr));
+      memcpy(chunk + used + sizeof(hdr), body, hdr.len);
+      used += frame_sz;
+    }
+    write_all(fd, chunk, used);
+  }
+}
+
+
+// read expect bytes of frames from the driver, checking that each one is
+// whole and none were interleaved
+static void drain(int fd, char *chunk, size_t expect) {
+  scewl_hdr_t hdr;
+  size_t got = 0, skip = 0;  // header bytes read, body bytes left to skip
+  ssize_t bread;
+  char *p;
+
+  while (expect) {
+    bread = read(fd, chunk, expect < CHUNK_SZ ? expect : CHUNK_SZ);
+    if (bread <= 0) {
+      perror("controller read");
+      exit(1);
+    }
+    expect -= bread;
+
+    for (p = chunk; p < chunk + bread;) {
+      if (skip) {
+        got = skip < chunk + bread - p ? skip : chunk + bread - p;
+        p += got;
+        skip -= got;
+        got = 0;
+        continue;
+      }
+
+      ((char *)&hdr)[got++] = *p++;
+      if (got == sizeof(hdr)) {
+        if (hdr.magicS != 'S' || hdr.magicC != 'C' || hdr.src_id != SCEWL_ID) {
+          fprintf(stderr, "controller: corrupt frame\n");
+          exit(1);
+        }
+        skip = hdr.len;
+        got = 0;
+      }
+    }
+  }
+}
+
+
+// the stand-in controller: send the driver its frames, drain everything it
+// sends back, then send more for the threaded mode
+static void controller(int listener) {
+  char *chunk = malloc(CHUNK_SZ);
+  size_t expect = 0;
+  int fd = accept(listener, NULL, NULL);
+
+  if (fd < 0 || !chunk) {
+    perror("controller accept");
+    exit(1);
+  }
+
+  // one registration each for bench_register, answered late like an SSS
+  // would, followed by what the SED sent while initializing
+  for (int i = 0; i < 2; i++) {
+    scewl_hdr_t hdr = { 'S', 'C', SCEWL_ID, SCEWL_SSS_ID, sizeof(scewl_sss_msg_t) };
+    scewl_sss_msg_t msg = { SCEWL_ID, SCEWL_SSS_REG };
+
+    drain(fd, chunk, sizeof(hdr) + sizeof(msg));
+    usleep(REG_DELAY_MS * 1000);
+    write_all(fd, (char *)&hdr, sizeof(hdr));
+    write_all(fd, (char *)&msg, sizeof(msg));
+    drain(fd, chunk, INIT_MSGS * (sizeof(hdr) + 16));
+  }
+
+  for (int i = 0; i < RECV_PASSES; i++) {
+    send_pass(fd, chunk);
+  }
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    expect += SEND_PASSES * sizes[i].frames * (sizeof(scewl_hdr_t) + sizes[i].len);
+  }
+  drain(fd, chunk, expect);
+
+#ifdef SCEWL_THREADS
+  drain(fd, chunk, expect / SEND_PASSES);
+  send_pass(fd, chunk);
+#endif
+
+  close(fd);
+  exit(0);
+}
+
+
+// SED startup: register, then initialize and send the first messages, with
+// scewl_register and with scewl_register_async overlapping the two
+static void register_init() {
+  for (int i = 0; i < INIT_MSGS; i++) {
+    scewl_send(SCEWL_FAA_ID, 16, body);
+  }
+  usleep(INIT_MS * 1000);
+}
+
+static void bench_register() {
+  struct pollfd pfd = { .fd = scewl_get_fd(), .events = POLLIN };
+  double start, sync_ms, async_ms;
+
+  start = now();
+  if (scewl_register() != SCEWL_OK) {
+    fprintf(stderr, "scewl_register failed\n");
+    exit(1);
+  }
+  register_init();
+  sync_ms = (now() - start) * 1e3;
+
+  start = now();
+  if (scewl_register_async(NULL, NULL) != SCEWL_OK) {
+    fprintf(stderr, "scewl_register_async failed\n");
+    exit(1);
+  }
+  register_init();
+  while (scewl_register_status() == SCEWL_PENDING) {
+    poll(&pfd, 1, -1);
+  }
+  async_ms = (now() - start) * 1e3;
+
+  if (scewl_register_status() != SCEWL_OK) {
+    fprintf(stderr, "scewl_register_async failed\n");
+    exit(1);
+  }
+  printf("startup, SSS replying in %dms and %dms of init:\n", REG_DELAY_MS, INIT_MS);
+  printf("  scewl_register       %6.1f ms\n", sync_ms);
+  printf("  scewl_register_async %6.1f ms, %.1f ms saved\n", async_ms, sync_ms - async_ms);
+  syscalls = 0;
+}
+
+
+static void bench_recv(char *buf) {
+  scewl_id_t src_id, tgt_id;
+  double start;
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    start = begin();
+    for (int j = 0; j < sizes[i].frames; j++) {
+      if (scewl_recv(buf, &src_id, &tgt_id, BUF_SZ, 1) != sizes[i].len) {
+        fprintf(stderr, "scewl_recv: bad frame %d of %dB\n", j, sizes[i].len);
+        exit(1);
+      }
+    }
+    report("scewl_recv", sizes[i].len, sizes[i].frames, start);
+  }
+}
+
+
+static void bench_view() {
+  scewl_id_t src_id, tgt_id;
+  char *view;
+  uint16_t len;
+  double start;
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    start = begin();
+    for (int j = 0; j < sizes[i].frames; j++) {
+      if (scewl_recv_view(&view, &len, &src_id, &tgt_id, -1) != SCEWL_OK ||
+          len != sizes[i].len) {
+        fprintf(stderr, "scewl_recv_view: bad frame %d of %dB\n", j, sizes[i].len);
+        exit(1);
+      }
+      scewl_release();
+    }
+    report("scewl_recv_view", sizes[i].len, sizes[i].frames, start);
+  }
+}
+
+
+// progress through sizes[] of the frames handled in bench_process
+static struct {
+  int size, frames;
+  double start;
+} handled;
+
+
+// FAA message handler for bench_process, reporting each size once all of
+// its frames have been handled
+static void count_frame(scewl_id_t src_id, scewl_id_t tgt_id, char *buf,
+                        uint16_t len, void *arg) {
+  if (len != sizes[handled.size].len) {
+    fprintf(stderr, "handler: bad frame %d of %dB\n", handled.frames, sizes[handled.size].len);
+    exit(1);
+  }
+
+  if (++handled.frames == sizes[handled.size].frames) {
+    report("scewl_process_ready", len, handled.frames, handled.start);
+    handled.size++;
+    handled.frames = 0;
+    handled.start = begin();
+  }
+}
+
+
+// receive the last pass of frames in a poll() loop
+static void bench_process() {
+  struct pollfd pfd = { .fd = scewl_get_fd(), .events = POLLIN };
+
+  scewl_set_handler(SCEWL_CLASS_FAA, count_frame, NULL);
+
+  handled.start = begin();
+  while (handled.size < NUM_SIZES) {
+    poll(&pfd, 1, -1);
+    if (scewl_process_ready() < 0) {
+      fprintf(stderr, "scewl_process_ready failed\n");
+      exit(1);
+    }
+  }
+
+  scewl_set_handler(SCEWL_CLASS_FAA, NULL, NULL);
+}
+
+
+// checking for messages that have not arrived
+static void bench_empty(char *buf) {
+  scewl_id_t src_id, tgt_id;
+  double start;
+
+  start = begin();
+  for (int j = 0; j < EMPTY_POLLS; j++) {
+    if (scewl_recv(buf, &src_id, &tgt_id, BUF_SZ, 0) != SCEWL_NO_MSG) {
+      fprintf(stderr, "scewl_recv: unexpected frame\n");
+      exit(1);
+    }
+  }
+  printf("%-19s  none: %9.0f calls/s %24.2f syscalls/call\n", "scewl_recv",
+         EMPTY_POLLS / (now() - start), (double)syscalls / EMPTY_POLLS);
+  syscalls = 0;
+
+  start = begin();
+  scewl_recv_timeout(buf, &src_id, &tgt_id, BUF_SZ, 100);
+  printf("%-19s  none: %9.1f ms for a 100 ms timeout\n", "scewl_recv_timeout",
+         (now() - start) * 1000);
+  syscalls = 0;
+}
+
+
+// write() the whole buffer as a blocking socket would, since the driver
+// keeps its socket non-blocking
+static int old_write(char *buf, size_t n) {
+  struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+  ssize_t written;
+
+  for (size_t done = 0; done < n; done += written) {
+    written = write(sock, buf + done, n - done);
+    if (written < 0) {
+      poll(&pfd, 1, -1);
+      written = 0;
+    }
+  }
+  return SCEWL_OK;
+}
+
+
+// the send path before scewl_send used writev
+static int old_send(scewl_id_t tgt_id, uint16_t len, char *data) {
+  scewl_hdr_t hdr = { 'S', 'C', tgt_id, SCEWL_ID, len };
+
+  old_write((char *)&hdr, sizeof(hdr));
+  return old_write(data, len);
+}
+
+
+static void bench_send() {
+  scewl_msg_t msgs[BATCH];
+  double start;
+  int frames, res;
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    frames = sizes[i].frames;
+
+    start = begin();
+    for (int j = 0; j < frames; j++) {
+      old_send(SCEWL_FAA_ID, sizes[i].len, body);
+    }
+    report("two writes", sizes[i].len, frames, start);
+
+    start = begin();
+    for (int j = 0; j < frames; j++) {
+      scewl_send(SCEWL_FAA_ID, sizes[i].len, body);
+    }
+    report("scewl_send", sizes[i].len, frames, start);
+
+    // fan out to a different target per message
+    for (int j = 0; j < BATCH; j++) {
+      msgs[j].tgt_id = SCEWL_FAA_ID + 1 + j;
+      msgs[j].len = sizes[i].len;
+      msgs[j].buf = body;
+    }
+
+    start = begin();
+    for (int j = 0; j < frames; j += BATCH) {
+      res = scewl_send_batch(msgs, frames - j < BATCH ? frames - j : BATCH);
+      if (res != SCEWL_OK) {
+        fprintf(stderr, "scewl_send_batch failed\n");
+        exit(1);
+      }
+    }
+    report("scewl_send_batch", sizes[i].len, frames, start);
+  }
+}
+
+
+#ifdef SCEWL_THREADS
+#include <pthread.h>
+#include <sched.h>
+
+// application threads sending or receiving at once
+#define THREADS 4
+
+// what a bench_threads thread sends or receives
+typedef struct {
+  int size;
+  scewl_queue_t *q;
+} thread_arg_t;
+
+
+static void *send_thread(void *arg) {
+  int size = ((thread_arg_t *)arg)->size;
+
+  // a full send queue fails the send, so wait for the I/O thread to catch up
+  for (int j = 0; j < sizes[size].frames / THREADS; j++) {
+    while (scewl_send(SCEWL_FAA_ID, sizes[size].len, body) != SCEWL_OK) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+
+static void *recv_thread(void *arg) {
+  thread_arg_t *t = arg;
+  scewl_id_t src_id, tgt_id;
+  char *buf = malloc(BUF_SZ);
+
+  for (int j = 0; j < sizes[t->size].frames; j++) {
+    if (scewl_queue_recv(t->q, buf, &src_id, &tgt_id, BUF_SZ, -1) != sizes[t->size].len) {
+      fprintf(stderr, "scewl_queue_recv: bad frame %d of %dB\n", j, sizes[t->size].len);
+      exit(1);
+    }
+  }
+  free(buf);
+  return NULL;
+}
+
+
+// THREADS threads sending at once, then each receiving every frame through
+// its own queue. A send is done once scewl_stop_io has written it
+static void bench_threads() {
+  pthread_t threads[THREADS];
+  thread_arg_t args[THREADS];
+  double start;
+  int frames;
+
+  // the controller sends another pass as soon as it has the last of these,
+  // which an I/O thread that is still running would drop without subscribers
+  for (int t = 0; t < THREADS; t++) {
+    args[t].q = scewl_subscribe(1 << SCEWL_CLASS_FAA);
+  }
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    frames = sizes[i].frames / THREADS * THREADS;
+
+    scewl_start_io();
+    start = begin();
+    for (int t = 0; t < THREADS; t++) {
+      args[t].size = i;
+      pthread_create(&threads[t], NULL, send_thread, &args[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+      pthread_join(threads[t], NULL);
+    }
+    scewl_stop_io();
+    report("scewl_send 4 thr", sizes[i].len, frames, start);
+  }
+
+  // received into the queues from above
+  scewl_start_io();
+
+  for (int i = 0; i < NUM_SIZES; i++) {
+    start = begin();
+    for (int t = 0; t < THREADS; t++) {
+      args[t].size = i;
+      pthread_create(&threads[t], NULL, recv_thread, &args[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+      pthread_join(threads[t], NULL);
+    }
+    report("queue_recv 4 thr", sizes[i].len, THREADS * sizes[i].frames, start);
+  }
+
+  scewl_stop_io();
+}
+#endif
+
+
+int main(void) {
+  struct sockaddr_un addr;
+  char *buf = malloc(BUF_SZ);
+  int listener, status;
+  pid_t pid;
+
+  memset(body, 'A', sizeof(body));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/scewl_bench_%d.sock", getpid());
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) ||
+      listen(listener, 1)) {
+    perror(addr.sun_path);
+    return 1;
+  }
+
+  pid = fork();
+  if (pid == 0) {
+    controller(listener);
+  }
+
+  setenv("SCEWL_BUS_SOCK", addr.sun_path, 1);
+  scewl_init();
+
+  bench_register();
+  bench_recv(buf);
+  bench_view();
+  bench_process();
+  bench_empty(buf);
+  bench_send();
+#ifdef SCEWL_THREADS
+  bench_threads();
+#endif
+#ifdef SCEWL_STATS
+  scewl_stats_dump();
+#endif
+
+  waitpid(pid, &status, 0);
+  unlink(addr.sun_path);
+  if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+    fprintf(stderr, "controller failed\n");
+    return 1;
+  }
+  return 0;
+}
@@ -23,12 +23,17 @@
 // type of a SCEWL ID
 typedef uint16_t scewl_id_t;
 
-// SCEWL_ID defined at compile
-#ifndef SCEWL_ID
+// SCEWL_ID defined at compile, except by SEDs using libscewl, which define
+// SCEWL_LIB instead and pass their ID to scewl_init_id
+#if !defined(SCEWL_ID) && !defined(SCEWL_LIB)
 #warning SCEWL_ID not defined, using bad default of 0
 #define SCEWL_ID 0
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 // SCEWL bus channel header
 typedef struct scewl_hdr_t {
@@ -46,8 +51,39 @@ typedef struct scewl_sss_msg_t {
   uint16_t   op;
 } scewl_sss_msg_t;
 
+// message to send with scewl_send_batch
+typedef struct scewl_msg_t {
+  scewl_id_t tgt_id;
+  uint16_t len;
+  char *buf;
+} scewl_msg_t;
+
+// classes of messages that can each have a handler, see scewl_set_handler
+enum scewl_class {
+  SCEWL_CLASS_DIRECT,  // sent to this device by another SED
+  SCEWL_CLASS_BRDCST,  // broadcast by another SED
+  SCEWL_CLASS_SSS,     // registration replies
+  SCEWL_CLASS_FAA,     // from the FAA transceiver
+  SCEWL_NUM_CLASSES
+};
+
+// mask of every class, for scewl_subscribe
+#define SCEWL_CLASS_ALL ((1 << SCEWL_NUM_CLASSES) - 1)
+
+// receive queue of one consumer thread, see scewl_subscribe
+typedef struct scewl_queue_t scewl_queue_t;
+
+// message handler. buf points into the driver's receive buffer and is only
+// valid until the handler returns
+typedef void (*scewl_handler_t)(scewl_id_t src_id, scewl_id_t tgt_id,
+                                char *buf, uint16_t len, void *arg);
+
+// called when a registration started by scewl_register_async completes, with
+// the status scewl_register would have returned
+typedef void (*scewl_reg_cb_t)(int status, void *arg);
+
 // SCEWL status codes
-enum scewl_status { SCEWL_ERR = -1, SCEWL_OK, SCEWL_ALREADY, SCEWL_NO_MSG };
+enum scewl_status { SCEWL_ERR = -1, SCEWL_OK, SCEWL_ALREADY, SCEWL_NO_MSG, SCEWL_PENDING };
 
 // registration/deregistration options
 enum scewl_sss_op_t { SCEWL_SSS_ALREADY = -1, SCEWL_SSS_REG, SCEWL_SSS_DEREG };
@@ -56,12 +92,36 @@ enum scewl_sss_op_t { SCEWL_SSS_ALREADY = -1, SCEWL_SSS_REG, SCEWL_SSS_DEREG };
 enum scewl_ids { SCEWL_BRDCST_ID, SCEWL_SSS_ID, SCEWL_FAA_ID };
 
 
+#ifndef SCEWL_LIB
 /*
  * scewl_init
  * 
  * Initializes the SCEWL Bus. Must be called before any other SCEWL function
  */
 void scewl_init();
+#endif
+
+
+/*
+ * scewl_init_id
+ *
+ * Initializes the SCEWL Bus as the device with the given ID, in place of
+ * scewl_init. Exits if the SCEWL Bus Controller cannot be reached
+ *
+ * Args:
+ *   id - SCEWL ID of this device
+ */
+void scewl_init_id(scewl_id_t id);
+
+
+/*
+ * scewl_close
+ *
+ * Closes the connection to the SCEWL Bus Controller and drops any messages
+ * held back or queued. scewl_stop_io must be called first if the I/O thread
+ * was started. scewl_init_id may be called again afterwards
+ */
+void scewl_close();
 
 
 /*
@@ -70,15 +130,59 @@ void scewl_init();
  * Registers the device with the SSS
  *
  * Returns:
- *   SCEWL_OK on success, SCEWL_ERR on failure or if already registered
+ *   SCEWL_OK on success
+ *   SCEWL_ALREADY if the SSS reports the device as already registered
+ *   SCEWL_ERR on failure, or if the SSS replies with any other op
  */
 int scewl_register();
 
 
+/*
+ * scewl_register_async
+ *
+ * Starts registering the device with the SSS without waiting for the reply,
+ * so that the SED can initialize meanwhile. The reply is taken by whichever
+ * receive, scewl_process_ready or scewl_register_status call reads it, and is
+ * not returned to the caller. Until then, messages sent to anything but the
+ * SSS are queued, within SCEWL_STASH_BUDGET bytes, then sent together once
+ * the device is registered, even if it already was, or dropped if
+ * registration fails, which includes the SSS replying with an unexpected op.
+ * Must be called before scewl_start_io, which fails while registration is in
+ * flight
+ *
+ * Args:
+ *   cb - called once registration completes, or NULL. It may send messages
+ *   arg - passed to cb
+ *
+ * Returns:
+ *   SCEWL_OK if the registration was sent
+ *   SCEWL_ERR if it could not be sent or another is in flight
+ */
+int scewl_register_async(scewl_reg_cb_t cb, void *arg);
+
+
+/*
+ * scewl_register_status
+ *
+ * Takes the reply to scewl_register_async if it has arrived, without
+ * waiting. Messages read before it are held back, as by scewl_recv_from, so
+ * event loops should rely on the callback from scewl_process_ready instead.
+ * Releases the message from scewl_recv_view
+ *
+ * Returns:
+ *   SCEWL_PENDING while the reply has not arrived
+ *   SCEWL_OK, SCEWL_ALREADY or SCEWL_ERR once it has, as scewl_register
+ *   SCEWL_ERR if scewl_register_async was never called
+ */
+int scewl_register_status();
+
+
 /*
  * scewl_deregister
  *
- * Deregisters the device from the SSS
+ * Deregisters the device from the SSS. Waits for the reply on the
+ * connection itself, so it fails without sending anything while the I/O
+ * thread runs; call scewl_stop_io first
  *
  * Returns:
  *   SCEWL_OK on success, SCEWL_ERR on failure or if already deregistered
@@ -89,7 +193,8 @@ int scewl_deregister();
 /*
  * scewl_recv
  *
- * Securely receives a message from another SCEWL device
+ * Securely receives a message from another SCEWL device. The same as
+ * scewl_recv_timeout waiting forever if blocking, or not at all if not
  *
  * Args:
  *   buf - pointer to a buffer that will be filled with the message
@@ -97,7 +202,8 @@ int scewl_deregister();
  *            ID of the message sender
  *   tgt_id - pointer to a src_id_t which will be filled with the device
  *            ID of the target (either this device's ID or SCEWL_BROADCAST_ID)
- *   n - the maximum number of bytes from a message that will be put in the buffer
+ *   n - the maximum number of bytes from a message that will be put in the
+ *       buffer. If the message is shorter, the byte after it is set to 0
  *   blocking - boolean of whether or not to block until a message is received
  *
  * Returns:
@@ -109,6 +215,95 @@ int scewl_recv(char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
                size_t n, int blocking);
 
 
+/*
+ * scewl_recv_timeout
+ *
+ * Securely receives a message from another SCEWL device, waiting a bounded
+ * time for one to arrive
+ *
+ * Args:
+ *   buf - pointer to a buffer that will be filled with the message
+ *   src_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the message sender
+ *   tgt_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the target (either this device's ID or SCEWL_BROADCAST_ID)
+ *   n - the maximum number of bytes from a message that will be put in the
+ *       buffer. If the message is shorter, the byte after it is set to 0
+ *   timeout_ms - milliseconds to wait for a message, 0 to only take one that
+ *                has already arrived, or negative to wait forever
+ *
+ * Returns:
+ *   Length of data received if message was received
+ *   SCEWL_NO_MSG if no message arrived in time
+ *   SCEWL_ERR if error
+ */
+int scewl_recv_timeout(char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
+                       size_t n, int timeout_ms);
+
+
+/*
+ * scewl_recv_from
+ *
+ * Securely receives the next message from one SCEWL device, such as a reply.
+ * Messages from other devices that arrive first are held back, by sender, and
+ * returned by later receives in the order they arrived. At most
+ * SCEWL_STASH_BUDGET bytes are held back (64 KB unless set at compile time),
+ * beyond which the oldest are dropped
+ *
+ * Args:
+ *   src_id - SCEWL ID of the device to receive from
+ *   buf - pointer to a buffer that will be filled with the message
+ *   tgt_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the target (either this device's ID or SCEWL_BROADCAST_ID)
+ *   n - the maximum number of bytes from a message that will be put in the
+ *       buffer. If the message is shorter, the byte after it is set to 0
+ *   timeout_ms - milliseconds to wait for a message, 0 to only take one that
+ *                has already arrived, or negative to wait forever
+ *
+ * Returns:
+ *   Length of data received if message was received
+ *   SCEWL_NO_MSG if no message arrived in time
+ *   SCEWL_ERR if error
+ */
+int scewl_recv_from(scewl_id_t src_id, char *buf, scewl_id_t *tgt_id,
+                    size_t n, int timeout_ms);
+
+
+/*
+ * scewl_recv_view
+ *
+ * Securely receives a message from another SCEWL device without copying it,
+ * like scewl_recv_timeout. The message stays in the driver's receive buffer
+ * until scewl_release or the next receive
+ *
+ * Args:
+ *   buf - pointer to a pointer which will be set to the message
+ *   len - pointer to a uint16_t which will be filled with the message length
+ *   src_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the message sender
+ *   tgt_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the target (either this device's ID or SCEWL_BROADCAST_ID)
+ *   timeout_ms - milliseconds to wait for a message, 0 to only take one that
+ *                has already arrived, or negative to wait forever
+ *
+ * Returns:
+ *   SCEWL_OK if a message was received
+ *   SCEWL_NO_MSG if no message arrived in time
+ *   SCEWL_ERR if error
+ */
+int scewl_recv_view(char **buf, uint16_t *len, scewl_id_t *src_id,
+                    scewl_id_t *tgt_id, int timeout_ms);
+
+
+/*
+ * scewl_release
+ *
+ * Releases the message returned by scewl_recv_view, after which its buffer
+ * must not be used. Does nothing if there is none
+ */
+void scewl_release();
+
+
 /*
  * scewl_send
  *
@@ -126,6 +321,25 @@ int scewl_recv(char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
 int scewl_send(scewl_id_t tgt_id, uint16_t len, char *buf);
 
 
+/*
+ * scewl_send_batch
+ *
+ * Securely sends a list of messages in order, packing as many frames as
+ * possible into each write to the SCEWL Bus Controller. Cheaper than calling
+ * scewl_send for each message when fanning out to many targets
+ *
+ * Args:
+ *   msgs - messages to send
+ *   n - number of messages
+ *
+ * Returns:
+ *   SCEWL_OK on success
+ *   SCEWL_ERR on failure, after which any number of the messages may
+ *   have been sent
+ */
+int scewl_send_batch(scewl_msg_t *msgs, int n);
+
+
 /*
  * scewl_brdcst
  *
@@ -142,4 +356,142 @@ int scewl_send(scewl_id_t tgt_id, uint16_t len, char *buf);
 int scewl_brdcst(uint16_t len, char *buf);
 
 
+
+/*
+ * scewl_get_fd
+ *
+ * Returns:
+ *   the descriptor of the connection to the SCEWL Bus Controller, to wait
+ *   on for readability with poll, select or epoll alongside the SED's own
+ *   descriptors and timers. Do not read from or write to it directly
+ */
+int scewl_get_fd();
+
+
+/*
+ * scewl_set_handler
+ *
+ * Sets the function scewl_process_ready calls for each message of a class.
+ * Handlers may send, but must not receive or call scewl_process_ready
+ *
+ * Args:
+ *   cls - class of messages to handle
+ *   fn - handler, or NULL to leave messages of the class for scewl_recv
+ *   arg - passed to every call of fn
+ */
+void scewl_set_handler(enum scewl_class cls, scewl_handler_t fn, void *arg);
+
+
+/*
+ * scewl_process_ready
+ *
+ * Without waiting, reads everything the SCEWL Bus Controller has sent so
+ * far and passes each whole message to the handler for its class. Call it
+ * whenever the descriptor from scewl_get_fd is readable. Messages are
+ * handled in order, so this stops at the first one of a class without a
+ * handler and leaves it and those after it to scewl_recv
+ *
+ * Returns:
+ *   the number of messages handled
+ *   SCEWL_ERR if the connection failed or closed and no messages were left
+ */
+int scewl_process_ready();
+
+
+
+/*
+ * scewl_stats_dump
+ *
+ * Writes the driver's counters to its log: latency histograms of scewl_send,
+ * of the wait in each receive and of registration round trips, and messages
+ * and bytes sent to and received from each peer. Only drivers built with
+ * STATS=1 (see the Makefile) keep them, others just say so
+ */
+void scewl_stats_dump();
+
+
+/*
+ * Threaded mode, only in drivers built with THREADS=1 (see the Makefile).
+ * SEDs using it must link with -pthread
+ */
+
+/*
+ * scewl_start_io
+ *
+ * Hands the connection to the SCEWL Bus Controller to a background I/O
+ * thread, after which any thread may call scewl_send, scewl_send_batch and
+ * scewl_brdcst at the same time. Sends only queue the message, so they never
+ * block; once SCEWL_SEND_BUDGET bytes are queued (64 KB unless set at compile
+ * time) they fail until the thread has written some out. Messages are
+ * received through the queues from scewl_subscribe, and scewl_recv,
+ * scewl_recv_view, scewl_process_ready and scewl_deregister fail. Register
+ * before starting the thread
+ *
+ * Returns:
+ *   SCEWL_OK on success
+ *   SCEWL_ERR if the thread could not be started
+ */
+int scewl_start_io();
+
+
+/*
+ * scewl_stop_io
+ *
+ * Sends everything already queued, then stops the I/O thread. Messages left
+ * in receive queues can still be taken
+ */
+void scewl_stop_io();
+
+
+/*
+ * scewl_subscribe
+ *
+ * Creates a receive queue for one consumer thread. The I/O thread copies
+ * each message to every queue subscribed to its class, and messages no queue
+ * subscribes to are dropped. A full queue holds up delivery to all of them,
+ * so each consumer must keep taking messages. Queues last until the program
+ * exits
+ *
+ * Args:
+ *   classes - mask of 1 << SCEWL_CLASS_* for the messages to queue, or
+ *             SCEWL_CLASS_ALL
+ *
+ * Returns:
+ *   the queue, or NULL if it could not be created
+ */
+scewl_queue_t *scewl_subscribe(unsigned classes);
+
+
+/*
+ * scewl_queue_recv
+ *
+ * Takes a message from a queue, like scewl_recv_timeout. Only the thread
+ * the queue belongs to may call it
+ *
+ * Args:
+ *   q - queue from scewl_subscribe
+ *   buf - pointer to a buffer that will be filled with the message
+ *   src_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the message sender
+ *   tgt_id - pointer to a src_id_t which will be filled with the device
+ *            ID of the target (either this device's ID or SCEWL_BROADCAST_ID)
+ *   n - the maximum number of bytes from a message that will be put in the
+ *       buffer. If the message is shorter, the byte after it is set to 0
+ *   timeout_ms - milliseconds to wait for a message, 0 to only take one that
+ *                has already arrived, or negative to wait forever
+ *
+ * Returns:
+ *   Length of data received if message was received
+ *   SCEWL_NO_MSG if no message arrived in time
+ *   SCEWL_ERR if the queue is empty and the I/O thread has stopped, whatever
+ *             the timeout
+ */
+int scewl_queue_recv(scewl_queue_t *q, char *buf, scewl_id_t *src_id,
+                     scewl_id_t *tgt_id, size_t n, int timeout_ms);
+
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // SCEWL_H
@@ -0,0 +1,290 @@
+/*
+ * 2021 Collegiate eCTF
+ * SCEWL bus driver C++ header
+ *
+ * Header-only C++20 layer over the driver, for sbd.o or libscewl: an RAII
+ * Bus, sends and receives over std::span, and coroutines that co_await
+ * bus.recv(). Bus::run resumes the waiting coroutines one message at a time,
+ * so any number of them can wait at once on a single thread
+ *
+ * (c) 2021 The MITRE Corporation
+ *
+ * This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+ * This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+ * and may not meet MITRE standards for quality. Use this code at your own risk!
+ */
+
+#ifndef SCEWL_HPP
+#define SCEWL_HPP
+
+// Bus takes the ID at run time, so SCEWL_ID need not be defined. The
+// definition is dropped again after the include so it does not change how
+// headers included later see the driver
+#ifndef SCEWL_LIB
+#define SCEWL_LIB
+#define SCEWL_HPP_DEFINED_LIB
+#endif
+
+#include "scewl_bus.h"
+
+#ifdef SCEWL_HPP_DEFINED_LIB
+#undef SCEWL_LIB
+#undef SCEWL_HPP_DEFINED_LIB
+#endif
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace scewl {
+
+// message received with Bus::recv into the caller's buffer, or with
+// Bus::view in the driver's
+struct Message {
+  scewl_id_t src_id = 0;
+  scewl_id_t tgt_id = 0;
+  std::span<char> data;
+};
+
+// message a coroutine received with co_await Bus::recv(), which it owns
+struct Received {
+  int status = SCEWL_ERR;  // SCEWL_OK, or SCEWL_ERR if the bus failed
+  scewl_id_t src_id = 0;
+  scewl_id_t tgt_id = 0;
+  std::vector<char> data;
+};
+
+// return type of coroutines that co_await Bus::recv(). They start when called
+// and free themselves when they return
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+
+// the connection to the SCEWL Bus Controller, closed when destroyed. The
+// driver has one connection per process, so there can only be one Bus at a
+// time
+class Bus {
+ public:
+  class RecvAwaiter;
+
+  /*
+   * Bus
+   *
+   * Connects to the SCEWL Bus Controller, see scewl_init_id
+   *
+   * Args:
+   *   id - SCEWL ID of this device
+   */
+  explicit Bus(scewl_id_t id) { scewl_init_id(id); }
+
+  // coroutines still waiting in recv are destroyed, never resumed
+  ~Bus();
+
+  Bus(const Bus &) = delete;
+  Bus &operator=(const Bus &) = delete;
+
+  // see scewl_register, scewl_register_async and scewl_deregister
+  int register_device() { return scewl_register(); }
+  int register_async(scewl_reg_cb_t cb = nullptr, void *arg = nullptr) {
+    return scewl_register_async(cb, arg);
+  }
+  int deregister_device() { return scewl_deregister(); }
+
+  // descriptor to wait on in other event loops before calling run(0)
+  int fd() const { return scewl_get_fd(); }
+
+  /*
+   * send
+   *
+   * Sends a message, see scewl_send
+   *
+   * Args:
+   *   tgt_id - SCEWL ID of the receiving device
+   *   data - message to send, at most 0xffff bytes
+   *
+   * Returns:
+   *   SCEWL_OK on success
+   *   SCEWL_ERR if it could not be sent or was too long
+   */
+  int send(scewl_id_t tgt_id, std::span<const char> data) {
+    if (data.size() > UINT16_MAX) {
+      return SCEWL_ERR;
+    }
+    return scewl_send(tgt_id, data.size(), const_cast<char *>(data.data()));
+  }
+
+  // broadcasts a message, as send
+  int brdcst(std::span<const char> data) { return send(SCEWL_BRDCST_ID, data); }
+
+  /*
+   * recv
+   *
+   * Receives the next message into buf, cutting it short if buf is smaller.
+   * Unlike scewl_recv, a length can never be mistaken for a status. Must not
+   * be mixed with coroutines waiting in recv(), which would miss the message
+   *
+   * Args:
+   *   buf - buffer to fill with the message
+   *   msg - filled with the sender, target and the part of buf filled
+   *   timeout_ms - as scewl_recv_timeout
+   *
+   * Returns:
+   *   SCEWL_OK, SCEWL_NO_MSG or SCEWL_ERR, as scewl_recv_view
+   */
+  int recv(std::span<char> buf, Message &msg, int timeout_ms = -1) {
+    int res = view(msg, timeout_ms);
+    size_t n;
+
+    if (res == SCEWL_OK) {
+      n = std::min(buf.size(), msg.data.size());
+      std::memcpy(buf.data(), msg.data.data(), n);
+      msg.data = buf.first(n);
+      scewl_release();
+    }
+    return res;
+  }
+
+  // receives the next message without copying it, as recv. msg.data points
+  // into the driver's buffer and is valid until the next receive
+  int view(Message &msg, int timeout_ms = -1) {
+    char *buf;
+    uint16_t len;
+    int res = scewl_recv_view(&buf, &len, &msg.src_id, &msg.tgt_id, timeout_ms);
+
+    if (res == SCEWL_OK) {
+      msg.data = std::span<char>(buf, len);
+    }
+    return res;
+  }
+
+  // awaits the next message in a coroutine: `Received msg = co_await
+  // bus.recv();`. Coroutines waiting at once are given messages in the order
+  // they started waiting, as run reads them
+  RecvAwaiter recv();
+
+  /*
+   * run
+   *
+   * Resumes the coroutines waiting in recv() as messages arrive, until none
+   * are left waiting. If the bus fails, every waiting coroutine is resumed
+   * with status SCEWL_ERR
+   *
+   * Args:
+   *   timeout_ms - milliseconds to wait for each message, 0 to only take
+   *                those that have already arrived, or negative to wait
+   *                forever
+   *
+   * Returns:
+   *   SCEWL_OK once no coroutine is waiting
+   *   SCEWL_NO_MSG if no message arrived in time
+   *   SCEWL_ERR if the bus failed
+   */
+  int run(int timeout_ms = -1);
+
+ private:
+  // take the next message for a waiting coroutine
+  static int take(Received &msg, int timeout_ms) {
+    char *buf;
+    uint16_t len;
+
+    msg.status = scewl_recv_view(&buf, &len, &msg.src_id, &msg.tgt_id, timeout_ms);
+    if (msg.status == SCEWL_OK) {
+      msg.data.assign(buf, buf + len);
+      scewl_release();
+    }
+    return msg.status;
+  }
+
+  std::deque<RecvAwaiter *> waiters_;
+};
+
+
+class Bus::RecvAwaiter {
+ public:
+  explicit RecvAwaiter(Bus &bus) : bus_(bus) {}
+
+  // messages that have arrived already are only taken here when no other
+  // coroutine is waiting, so that those waiting longer get theirs first
+  bool await_ready() {
+    return bus_.waiters_.empty() && take(msg_, 0) != SCEWL_NO_MSG;
+  }
+
+  void await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    bus_.waiters_.push_back(this);
+  }
+
+  Received await_resume() { return std::move(msg_); }
+
+ private:
+  friend class Bus;
+
+  Bus &bus_;
+  Received msg_;
+  std::coroutine_handle<> handle_;
+};
+
+
+inline Bus::~Bus() {
+  std::coroutine_handle<> h;
+
+  while (!waiters_.empty()) {
+    h = waiters_.front()->handle_;
+    waiters_.pop_front();
+    h.destroy();
+  }
+  scewl_close();
+}
+
+
+inline Bus::RecvAwaiter Bus::recv() {
+  return RecvAwaiter(*this);
+}
+
+
+inline int Bus::run(int timeout_ms) {
+  RecvAwaiter *w;
+  int res;
+
+  while (!waiters_.empty()) {
+    w = waiters_.front();
+    res = take(w->msg_, timeout_ms);
+    if (res == SCEWL_NO_MSG) {
+      return res;
+    }
+
+    // a resumed coroutine may wait again, behind the others
+    waiters_.pop_front();
+    w->handle_.resume();
+
+    if (res == SCEWL_ERR) {
+      // nothing more will arrive, so let every coroutine see it. Any that
+      // wait again see it straight away in await_ready
+      std::deque<RecvAwaiter *> failed;
+      failed.swap(waiters_);
+      for (RecvAwaiter *f : failed) {
+        f->msg_.status = SCEWL_ERR;
+        f->handle_.resume();
+      }
+      return res;
+    }
+  }
+  return SCEWL_OK;
+}
+
+}  // namespace scewl
+
+#endif // SCEWL_HPP
@@ -16,18 +16,286 @@
 #include "scewl_bus.h"
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <stdlib.h>
 
+// largest frame the controller can send
+#define MAX_FRAME (sizeof(scewl_hdr_t) + 0xffff)
+
+// receive buffer size. Twice the largest frame, so that unread bytes only
+// need moving to the front once half of it has been consumed
+#define RX_SZ (2 * MAX_FRAME)
+
+// frames per writev() call in scewl_send_batch, two iovecs each. Linux
+// accepts up to 1024 iovecs per call
+#define BATCH_FRAMES 512
+
+// sources scewl_recv_from can hold frames back from at once
+#define STASH_SOURCES 16
+
+// bytes of frames scewl_recv_from may hold back, after which the oldest are
+// dropped. Can be set at compile time
+#ifndef SCEWL_STASH_BUDGET
+#define SCEWL_STASH_BUDGET 0x10000
+#endif
+
+// source ID meaning any source
+#define ANY_SRC -1
+
+// asynchronous registration, after the send functions
+static int reg_queue(scewl_id_t tgt_id, uint16_t len, char *data);
+static int reg_reply(scewl_hdr_t *hdr);
+
+#ifdef SCEWL_THREADS
+// the threaded mode at the end of this file
+static int io_running();
+static int tx_push(scewl_id_t tgt_id, uint16_t len, char *data);
+#endif
+
 int sock;
 FILE *logfp;
 
+// this device's SCEWL ID, given to scewl_init_id
+static scewl_id_t self_id;
+
+// bytes read from the socket in bulk, of which scewl_recv has not returned
+// those from head to tail yet. Frames are parsed in place. The held bytes at
+// head are a frame returned by scewl_recv_view and not yet released
+static struct {
+  char buf[RX_SZ];
+  size_t head, tail, held;
+} rx;
+
+// frame held back by scewl_recv_from while it waited for another source, or
+// queued to be sent once scewl_register_async completes
+typedef struct stashed_t {
+  struct stashed_t *next;
+  unsigned long seq;
+  scewl_hdr_t hdr;
+  char body[];
+} stashed_t;
+
+// frames held back, queued by source. Receives for any source take the
+// oldest first, by seq, so that the order they arrived in is kept
+static struct {
+  struct {
+    scewl_id_t src_id;
+    stashed_t *head, *tail;  // unused while head is NULL
+  } queues[STASH_SOURCES];
+  size_t bytes;
+  unsigned long seq;
+  stashed_t *held;  // returned by scewl_recv_view, freed on release
+} stash;
+
+// handlers set with scewl_set_handler, by message class
+static struct {
+  scewl_handler_t fn;
+  void *arg;
+} handlers[SCEWL_NUM_CLASSES];
+
+// registration started by scewl_register_async, and the frames sent while it
+// is in flight, which are packed already
+static struct {
+  int state;  // result of the last registration, or SCEWL_PENDING
+  scewl_reg_cb_t cb;
+  void *arg;
+  stashed_t *head, *tail;
+  size_t bytes;
+#ifdef SCEWL_STATS
+  uint64_t start;  // when the request was sent, for the sss histogram
+#endif
+} reg = { .state = SCEWL_ERR };
+
+
+#ifdef SCEWL_STATS
+/*
+ * Instrumentation, built in with STATS=1 (see the Makefile). Latencies go in
+ * log-linear histograms like HdrHistogram's: 16 linear buckets per power of
+ * two of nanoseconds, so each bucket is within 1/16 of its values, up to
+ * 2^40 ns. Messages and bytes are counted per peer
+ */
+
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (37 * HIST_SUB)
+#define HIST_MAX ((1ULL << 40) - 1)
+
+// peers counted separately, the rest are counted together
+#define STATS_PEERS 16
+
+typedef struct {
+  uint32_t counts[HIST_BUCKETS];
+  uint64_t n, max;
+} hist_t;
+
+static struct {
+  hist_t send, recv_wait, sss;
+  struct {
+    scewl_id_t id;
+    uint64_t sent, sent_bytes, recvd, recvd_bytes;
+  } peers[STATS_PEERS + 1];
+  int npeers;
+} stats;
+
+#ifdef SCEWL_THREADS
+#include <pthread.h>
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#define STATS_LOCK()   pthread_mutex_lock(&stats_lock)
+#define STATS_UNLOCK() pthread_mutex_unlock(&stats_lock)
+#else
+#define STATS_LOCK()
+#define STATS_UNLOCK()
+#endif
+
+#define STATS_START(t)          uint64_t t = stats_now()
+#define STATS_MARK(t)           t = stats_now()
+#define STATS_TIME(h, t)        stats_time(&stats.h, t)
+#define STATS_SENT(id, len)     stats_count(id, len, 1)
+#define STATS_RECEIVED(id, len) stats_count(id, len, 0)
+
+
+static uint64_t stats_now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// histogram bucket of a value. Values below HIST_SUB get a bucket each,
+// larger ones are bucketed by their top HIST_SUB_BITS + 1 bits
+static int hist_bucket(uint64_t v) {
+  int shift;
+
+  if (v < HIST_SUB) {
+    return v;
+  }
+  v = v < HIST_MAX ? v : HIST_MAX;
+  shift = 63 - __builtin_clzll(v) - HIST_SUB_BITS;
+  return shift * HIST_SUB + (v >> shift);
+}
+
+
+// lowest value in a histogram bucket
+static uint64_t hist_value(int bucket) {
+  if (bucket < 2 * HIST_SUB) {
+    return bucket;
+  }
+  return (uint64_t)(bucket % HIST_SUB + HIST_SUB) << (bucket / HIST_SUB - 1);
+}
+
+
+// record the time since start
+static void stats_time(hist_t *h, uint64_t start) {
+  uint64_t ns = stats_now() - start;
+
+  STATS_LOCK();
+  h->counts[hist_bucket(ns)]++;
+  h->n++;
+  h->max = ns > h->max ? ns : h->max;
+  STATS_UNLOCK();
+}
+
+
+// count a message sent to or received from a peer
+static void stats_count(scewl_id_t id, uint16_t len, int sent) {
+  int i;
+
+  STATS_LOCK();
+  for (i = 0; i < stats.npeers && stats.peers[i].id != id; i++) {
+  }
+  if (i == stats.npeers && i < STATS_PEERS) {
+    stats.peers[stats.npeers++].id = id;
+  }
+
+  if (sent) {
+    stats.peers[i].sent++;
+    stats.peers[i].sent_bytes += len;
+  } else {
+    stats.peers[i].recvd++;
+    stats.peers[i].recvd_bytes += len;
+  }
+  STATS_UNLOCK();
+}
+
+
+// smallest value at or above fraction p of a histogram's values
+static uint64_t hist_percentile(hist_t *h, double p) {
+  uint64_t want = p * h->n + 0.5, seen = 0;
+
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen >= want && seen) {
+      return hist_value(i);
+    }
+  }
+  return h->max;
+}
+
+
+static void hist_dump(char *name, hist_t *h) {
+  fprintf(logfp, "  %-10s n=%-8llu", name, (unsigned long long)h->n);
+  if (h->n) {
+    fprintf(logfp, " p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f us",
+            hist_percentile(h, 0.5) / 1e3, hist_percentile(h, 0.9) / 1e3,
+            hist_percentile(h, 0.99) / 1e3, hist_percentile(h, 0.999) / 1e3, h->max / 1e3);
+  }
+  fprintf(logfp, "\n");
+}
+
+
+void scewl_stats_dump() {
+  STATS_LOCK();
+  fprintf(logfp, "scewl stats:\n");
+  hist_dump("send", &stats.send);
+  hist_dump("recv wait", &stats.recv_wait);
+  hist_dump("sss rtt", &stats.sss);
+
+  for (int i = 0; i <= STATS_PEERS; i++) {
+    if (i < stats.npeers) {
+      fprintf(logfp, "  peer %-5d", stats.peers[i].id);
+    } else if (i == STATS_PEERS && (stats.peers[i].sent || stats.peers[i].recvd)) {
+      fprintf(logfp, "  others    ");
+    } else {
+      continue;
+    }
+    fprintf(logfp, " sent %llu msgs %llu B, received %llu msgs %llu B\n",
+            (unsigned long long)stats.peers[i].sent, (unsigned long long)stats.peers[i].sent_bytes,
+            (unsigned long long)stats.peers[i].recvd, (unsigned long long)stats.peers[i].recvd_bytes);
+  }
+  STATS_UNLOCK();
+}
+#else
+#define STATS_START(t)
+#define STATS_MARK(t)
+#define STATS_TIME(h, t)
+#define STATS_SENT(id, len)     do {} while (0)
+#define STATS_RECEIVED(id, len) do {} while (0)
 
+void scewl_stats_dump() {
+  fprintf(logfp, "scewl stats: not built in, see STATS in the driver Makefile\n");
+}
+#endif
+
+
+#ifndef SCEWL_LIB
 void scewl_init() {
+  scewl_init_id(SCEWL_ID);
+}
+#endif
+
+
+void scewl_init_id(scewl_id_t id) {
+  self_id = id;
+
   // NOTE: if you want to write logs to a file in the Docker container
   // filesystem for debugging, change stderr to a call to fopen
   logfp = stderr;
@@ -35,7 +303,11 @@ void scewl_init() {
   // create socket
   // NOTE: This is how the CPU communicates with the SCEWL Bus Controller in the
   // emulated setup -- a Unix socket mapped into the CPU's Docker container
-  char *sock_path = "/socks/scewl_bus.sock";
+  // SCEWL_BUS_SOCK can point the driver elsewhere, e.g. for the benchmarks
+  char *sock_path = getenv("SCEWL_BUS_SOCK");
+  if (!sock_path) {
+    sock_path = "/socks/scewl_bus.sock";
+  }
   struct sockaddr_un addr;
   sock = socket(AF_UNIX, SOCK_STREAM, 0);
   if (sock < 1) {
@@ -51,14 +323,43 @@ void scewl_init() {
     fprintf(logfp, "Could not connect to %s!", sock_path);
     exit(-1);
   }
+
+  // keep the socket non-blocking, waiting for it in poll() instead, so that
+  // neither direction needs mode switches and receives can time out
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+  rx.head = rx.tail = rx.held = 0;
+}
+
+
+// status of a registration from the SSS reply of len bytes: REG on success,
+// ALREADY if the SSS had the device registered. Anything else, including a
+// reply too short to hold an op, is an error
+static int reg_status(const scewl_sss_msg_t *msg, int len) {
+  if (len < (int)sizeof(*msg)) {
+    fprintf(logfp, "unexpected registration reply\n");
+    return SCEWL_ERR;
+  }
+  if (msg->op == SCEWL_SSS_REG) {
+    return SCEWL_OK;
+  }
+  if (msg->op == (uint16_t)SCEWL_SSS_ALREADY) {
+    fprintf(logfp, "already registered\n");
+    return SCEWL_ALREADY;
+  }
+  fprintf(logfp, "unexpected registration reply\n");
+  return SCEWL_ERR;
 }
 
 
 int scewl_register() {
-  scewl_id_t dummy; // we don't care about src/tgt here
+  scewl_id_t dummy; // we don't care about tgt here
   scewl_sss_msg_t msg;
+  int len;
 
-  msg.dev_id = SCEWL_ID;
+  STATS_START(start);
+
+  msg.dev_id = self_id;
   msg.op = SCEWL_SSS_REG;
 
   // send registration
@@ -67,27 +368,32 @@ int scewl_register() {
     return SCEWL_ERR;
   }
 
-  // receive response
-  if (scewl_recv((char *)&msg, &dummy, &dummy, sizeof(msg), 1) == SCEWL_ERR) {
+  // receive response, holding back any other messages for later
+  len = scewl_recv_from(SCEWL_SSS_ID, (char *)&msg, &dummy, sizeof(msg), -1);
+  if (len == SCEWL_ERR) {
     fprintf(logfp, "failed to register\n");
     return SCEWL_ERR;
   }
+  STATS_TIME(sss, start);
 
-  // op should be REG on success
-  if (msg.op == SCEWL_SSS_REG) {
-    return SCEWL_OK;
-  }
-  fprintf(logfp, "already registered\n");
-  return SCEWL_ALREADY;
+  return reg_status(&msg, len);
 }
 
 
 int scewl_deregister() {
-  scewl_id_t src_id;
   scewl_id_t tgt_id;
   scewl_sss_msg_t msg;
 
-  msg.dev_id = SCEWL_ID;
+#ifdef SCEWL_THREADS
+  // the reply would go to the I/O thread, so fail before sending anything
+  if (io_running()) {
+    return SCEWL_ERR;
+  }
+#endif
+
+  STATS_START(start);
+
+  msg.dev_id = self_id;
   msg.op = SCEWL_SSS_DEREG;
 
   // send deregistration
@@ -96,14 +402,13 @@ int scewl_deregister() {
     return SCEWL_ERR;
   }
 
-  // Wait until an SSS message is returned
-  do {
-    // receive response
-    if (scewl_recv((char *)&msg, &src_id, &tgt_id, sizeof(msg), 1) == SCEWL_ERR) {
-      fprintf(logfp, "failed to deregister\n");
-      return SCEWL_ERR;
-    }
-  } while (src_id != SCEWL_SSS_ID);
+  // wait until an SSS message is returned, holding back any other messages
+  // for later
+  if (scewl_recv_from(SCEWL_SSS_ID, (char *)&msg, &tgt_id, sizeof(msg), -1) == SCEWL_ERR) {
+    fprintf(logfp, "failed to deregister\n");
+    return SCEWL_ERR;
+  }
+  STATS_TIME(sss, start);
 
   // op should be DEREG on success
   if (msg.op == SCEWL_SSS_DEREG) {
@@ -114,114 +419,1064 @@ int scewl_deregister() {
 }
 
 
-// read a full number of bytes, breaking if error
-// or if non-blocking and no bytes available
-int full_read(int sock, void *vbuf, int n) {
-  char *buf = (char *)vbuf;
-  int bread, bread_tot = 0;
+// read as much as the socket has into the receive buffer. Returns SCEWL_OK
+// if anything was read, SCEWL_NO_MSG if it has nothing yet, or SCEWL_ERR if
+// it failed or was closed
+static int rx_fill() {
+  ssize_t bread;
+
+  // move the unread bytes to the front once past the halfway mark, which
+  // always leaves room for the rest of a frame starting at head
+  if (rx.head == rx.tail) {
+    rx.head = rx.tail = 0;
+  } else if (rx.head > RX_SZ - MAX_FRAME) {
+    memmove(rx.buf, rx.buf + rx.head, rx.tail - rx.head);
+    rx.tail -= rx.head;
+    rx.head = 0;
+  }
 
   do {
-    bread = read(sock, buf + bread_tot, n - bread_tot);
-    bread_tot += bread;
-  // break loop if read returned error or if header was all read
-  } while (bread > 0 && bread_tot < n);
-  return bread_tot;
+    bread = read(sock, rx.buf + rx.tail, RX_SZ - rx.tail);
+  } while (bread < 0 && errno == EINTR);
+
+  if (bread > 0) {
+    rx.tail += bread;
+    return SCEWL_OK;
+  }
+  if (bread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return SCEWL_NO_MSG;
+  }
+  return SCEWL_ERR;
 }
 
 
-int scewl_recv(char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
-               size_t n, int blocking) {
-  scewl_hdr_t hdr;
-  int res=SCEWL_OK, max, bread, flags, dummy;
+// milliseconds on a clock that never jumps
+static long now_ms() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+
+// wait up to timeout_ms, or forever if negative, for the socket to become
+// readable. Returns SCEWL_OK if it may be, SCEWL_NO_MSG on timeout, or
+// SCEWL_ERR
+static int rx_wait(int timeout_ms) {
+  struct pollfd pfd = { .fd = sock, .events = POLLIN };
+  int res = poll(&pfd, 1, timeout_ms);
+
+  if (res > 0 || (res < 0 && errno == EINTR)) {
+    return SCEWL_OK;
+  }
+  return res == 0 ? SCEWL_NO_MSG : SCEWL_ERR;
+}
+
+
+// wait up to timeout_ms, or forever if negative, until a whole frame is
+// buffered at rx.head, dropping any bytes before its "SC" magic. Returns
+// SCEWL_OK with the frame header copied to hdr, SCEWL_NO_MSG on timeout, or
+// SCEWL_ERR
+static int rx_frame(scewl_hdr_t *hdr, int timeout_ms) {
+  long deadline = timeout_ms > 0 ? now_ms() + timeout_ms : 0, left = -1;
+  char *start;
+  size_t avail;
+  int res;
 
-  // set blocking
-  flags = fcntl(sock, F_GETFL, 0);
-  if (blocking) {
-    flags &= ~O_NONBLOCK;
+  // a view is only valid until the next receive
+  scewl_release();
+
+  for (;;) {
+    avail = rx.tail - rx.head;
+    start = memchr(rx.buf + rx.head, 'S', avail);
+
+    if (!start) {
+      // nothing that could start a header
+      rx.head = rx.tail;
+    } else {
+      rx.head = start - rx.buf;
+      avail = rx.tail - rx.head;
+
+      if (avail >= 2 && start[1] != 'C') {
+        // not a header, look for the next S
+        rx.head++;
+        continue;
+      }
+
+      // the header may not be aligned in the buffer
+      if (avail >= sizeof(*hdr)) {
+        memcpy(hdr, start, sizeof(*hdr));
+        if (avail >= sizeof(*hdr) + hdr->len) {
+          return SCEWL_OK;
+        }
+      }
+    }
+
+    res = rx_fill();
+    if (res == SCEWL_NO_MSG && timeout_ms) {
+      if (timeout_ms > 0 && (left = deadline - now_ms()) <= 0) {
+        return SCEWL_NO_MSG;
+      }
+      res = rx_wait(left);
+    }
+    if (res != SCEWL_OK) {
+      return res;
+    }
+  }
+}
+
+
+// index of the stash queue with the oldest frame from src_id, or -1 if none
+static int stash_find(int src_id) {
+  int found = -1;
+
+  for (int i = 0; i < STASH_SOURCES; i++) {
+    if (!stash.queues[i].head) {
+      continue;
+    }
+    if (src_id == ANY_SRC) {
+      if (found < 0 || stash.queues[i].head->seq < stash.queues[found].head->seq) {
+        found = i;
+      }
+    } else if (stash.queues[i].src_id == src_id) {
+      return i;
+    }
+  }
+  return found;
+}
+
+
+// remove the oldest frame from a stash queue
+static stashed_t *stash_pop(int q) {
+  stashed_t *frame = stash.queues[q].head;
+
+  stash.queues[q].head = frame->next;
+  stash.bytes -= sizeof(frame->hdr) + frame->hdr.len;
+  return frame;
+}
+
+
+// hold back a copy of a frame from the receive buffer, dropping the oldest
+// frames held back to stay within the budget and the number of sources
+static void stash_put(scewl_hdr_t *hdr, char *body) {
+  size_t sz = sizeof(*hdr) + hdr->len;
+  stashed_t *frame;
+  int q;
+
+  if (sz > SCEWL_STASH_BUDGET) {
+    fprintf(logfp, "receive budget too small, dropped frame from %d\n", hdr->src_id);
+    return;
+  }
+
+  for (;;) {
+    q = stash_find(hdr->src_id);
+    for (int i = 0; q < 0 && i < STASH_SOURCES; i++) {
+      if (!stash.queues[i].head) {
+        q = i;
+      }
+    }
+    if (q >= 0 && stash.bytes + sz <= SCEWL_STASH_BUDGET) {
+      break;
+    }
+
+    frame = stash_pop(stash_find(ANY_SRC));
+    fprintf(logfp, "receive budget full, dropped frame from %d\n", frame->hdr.src_id);
+    free(frame);
+  }
+
+  if (!(frame = malloc(sizeof(*frame) + hdr->len))) {
+    fprintf(logfp, "out of memory, dropped frame from %d\n", hdr->src_id);
+    return;
+  }
+  frame->next = NULL;
+  frame->seq = stash.seq++;
+  frame->hdr = *hdr;
+  memcpy(frame->body, body, hdr->len);
+  stash.bytes += sz;
+
+  if (stash.queues[q].head) {
+    stash.queues[q].tail->next = frame;
   } else {
-    flags |= O_NONBLOCK;
+    stash.queues[q].src_id = hdr->src_id;
+    stash.queues[q].head = frame;
   }
-  fcntl(sock, F_SETFL, flags);
+  stash.queues[q].tail = frame;
+}
 
-  // clear buffer and header
-  memset(&hdr, 0, sizeof(hdr));
-  memset(buf, 0, n);
 
-  // find header start
-  do {
-    hdr.magicC = 0;
+// receive the next frame from src_id, or from any source, without copying
+// it. Frames from other sources that arrive first are held back for later
+static int recv_view_from(int src_id, scewl_hdr_t *hdr, char **body, int timeout_ms) {
+  long deadline = timeout_ms > 0 ? now_ms() + timeout_ms : 0;
+  int q, res;
+  STATS_START(start);
 
-    // check for S
-    if (read(sock, &hdr.magicS, 1) < 1) {
-      return SCEWL_NO_MSG;
+#ifdef SCEWL_THREADS
+  // the I/O thread owns the socket, receive from a queue instead
+  if (io_running()) {
+    return SCEWL_ERR;
+  }
+#endif
+
+  // a view is only valid until the next receive
+  scewl_release();
+
+  // frames held back earlier come first
+  if ((q = stash_find(src_id)) >= 0) {
+    stash.held = stash_pop(q);
+    *hdr = stash.held->hdr;
+    *body = stash.held->body;
+    STATS_TIME(recv_wait, start);
+    STATS_RECEIVED(hdr->src_id, hdr->len);
+    return SCEWL_OK;
+  }
+
+  for (;;) {
+    // a frame is only consumed once all of it has arrived, so a call that
+    // times out never leaves half of one behind
+    if ((res = rx_frame(hdr, timeout_ms)) != SCEWL_OK) {
+      return res;
     }
 
-    // check for SC
-    if (hdr.magicS == 'S') {
-      do {
-        if (read(sock, &hdr.magicC, 1) < 1) {
-          return SCEWL_NO_MSG;
-        }
-      } while (hdr.magicC == 'S'); // in case multiple 'S's in a row
+    // hold the frame in the buffer until released
+    *body = rx.buf + rx.head + sizeof(*hdr);
+    if (reg_reply(hdr)) {
+      // the reply to scewl_register_async is the driver's own
+    } else if (src_id == ANY_SRC || hdr->src_id == src_id) {
+      rx.held = sizeof(*hdr) + hdr->len;
+      STATS_TIME(recv_wait, start);
+      STATS_RECEIVED(hdr->src_id, hdr->len);
+      return SCEWL_OK;
+    } else {
+      stash_put(hdr, *body);
+      rx.head += sizeof(*hdr) + hdr->len;
     }
-  } while (hdr.magicS != 'S' && hdr.magicC != 'C');
 
-  // read rest of header
-  if (full_read(sock, ((char *)&hdr) + 2, sizeof(hdr) - 2) < sizeof(hdr) - 2) {
-    res = SCEWL_NO_MSG;
+    // take frames already buffered even once the time is up
+    if (timeout_ms > 0 && (timeout_ms = deadline - now_ms()) <= 0) {
+      timeout_ms = 0;
+    }
+  }
+}
+
+
+// copy a received message out, throwing away the rest if too long
+static int copy_view(char *buf, size_t n, char *view, uint16_t len) {
+  int max = len < n ? len : n;
+
+  memcpy(buf, view, max);
+  scewl_release();
+
+  // terminate messages used as strings. Only this byte is cleared, not the
+  // whole buffer
+  if (max < n) {
+    buf[max] = 0;
+  }
+  return max;
+}
+
+
+int scewl_recv_view(char **buf, uint16_t *len, scewl_id_t *src_id,
+                    scewl_id_t *tgt_id, int timeout_ms) {
+  scewl_hdr_t hdr;
+  int res;
+
+  if ((res = recv_view_from(ANY_SRC, &hdr, buf, timeout_ms)) != SCEWL_OK) {
+    return res;
   }
 
   // unpack header
   *src_id = hdr.src_id;
   *tgt_id = hdr.tgt_id;
+  *len = hdr.len;
+  return SCEWL_OK;
+}
 
-  // read body
-  max = hdr.len < n ? hdr.len : n;
-  bread = full_read(sock, buf, max);
 
-  // throw away rest of message if too long
-  for (int i = 0; hdr.len > max && i < hdr.len - max; i++) {
-    read(sock, &dummy, 1);
-  }
+void scewl_release() {
+  rx.head += rx.held;
+  rx.held = 0;
+  free(stash.held);
+  stash.held = NULL;
+}
 
-  // report if not blocking and full message not received
-  if(res == SCEWL_NO_MSG || bread < max) {
-    fprintf(logfp, "NO MSG: res: %d == %d || bread: %d < max %d\n", res, SCEWL_NO_MSG, bread, max);
-    return SCEWL_NO_MSG;
+
+int scewl_recv_timeout(char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
+                       size_t n, int timeout_ms) {
+  scewl_hdr_t hdr;
+  char *view;
+  int res;
+
+  if ((res = recv_view_from(ANY_SRC, &hdr, &view, timeout_ms)) != SCEWL_OK) {
+    return res;
   }
 
-  return max;
+  *src_id = hdr.src_id;
+  *tgt_id = hdr.tgt_id;
+  return copy_view(buf, n, view, hdr.len);
 }
 
 
-int scewl_send(scewl_id_t tgt_id, uint16_t len, char *data) {
+int scewl_recv_from(scewl_id_t src_id, char *buf, scewl_id_t *tgt_id,
+                    size_t n, int timeout_ms) {
   scewl_hdr_t hdr;
-  size_t written;
+  char *view;
+  int res;
 
-  // pack header
-  hdr.magicS  = 'S';
-  hdr.magicC  = 'C';
-  hdr.src_id = SCEWL_ID;
-  hdr.tgt_id = tgt_id;
-  hdr.len    = len;
+  if ((res = recv_view_from(src_id, &hdr, &view, timeout_ms)) != SCEWL_OK) {
+    return res;
+  }
 
-  // send header
-  written = write(sock, &hdr, sizeof(hdr));
-  if (written < sizeof(hdr)) {
-    return SCEWL_ERR;
+  *tgt_id = hdr.tgt_id;
+  return copy_view(buf, n, view, hdr.len);
+}
+
+
+int scewl_recv(char *buf, scewl_id_t *src_id, scewl_id_t *tgt_id,
+               size_t n, int blocking) {
+  return scewl_recv_timeout(buf, src_id, tgt_id, n, blocking ? -1 : 0);
+}
+
+
+int scewl_get_fd() {
+  return sock;
+}
+
+
+void scewl_set_handler(enum scewl_class cls, scewl_handler_t fn, void *arg) {
+  handlers[cls].fn = fn;
+  handlers[cls].arg = arg;
+}
+
+
+// the class of a message, for picking its handler
+static enum scewl_class classify(scewl_hdr_t *hdr) {
+  if (hdr->src_id == SCEWL_SSS_ID) {
+    return SCEWL_CLASS_SSS;
+  }
+  if (hdr->src_id == SCEWL_FAA_ID) {
+    return SCEWL_CLASS_FAA;
   }
+  return hdr->tgt_id == SCEWL_BRDCST_ID ? SCEWL_CLASS_BRDCST : SCEWL_CLASS_DIRECT;
+}
+
+
+int scewl_process_ready() {
+  scewl_hdr_t hdr;
+  enum scewl_class cls;
+  stashed_t *frame;
+  char *body;
+  int q, res, handled = 0;
 
-  // send body
-  written = write(sock, data, len);
-  if (written < len) {
+#ifdef SCEWL_THREADS
+  if (io_running()) {
     return SCEWL_ERR;
   }
+#endif
+
+  // frames held back by scewl_recv_from arrived first
+  scewl_release();
+  while ((q = stash_find(ANY_SRC)) >= 0) {
+    frame = stash.queues[q].head;
+    cls = classify(&frame->hdr);
+    if (!handlers[cls].fn) {
+      return handled;
+    }
+
+    stash_pop(q);
+    STATS_RECEIVED(frame->hdr.src_id, frame->hdr.len);
+    handlers[cls].fn(frame->hdr.src_id, frame->hdr.tgt_id, frame->body, frame->hdr.len,
+                     handlers[cls].arg);
+    free(frame);
+    handled++;
+  }
 
+  // rx_frame only gives up once the socket has nothing more to read, so
+  // edge-triggered event loops see every frame
+  while ((res = rx_frame(&hdr, 0)) == SCEWL_OK) {
+    if (reg_reply(&hdr)) {
+      continue;
+    }
+
+    cls = classify(&hdr);
+    if (!handlers[cls].fn) {
+      // leave it for scewl_recv
+      return handled;
+    }
+
+    body = rx.buf + rx.head + sizeof(hdr);
+    rx.head += sizeof(hdr) + hdr.len;
+    STATS_RECEIVED(hdr.src_id, hdr.len);
+    handlers[cls].fn(hdr.src_id, hdr.tgt_id, body, hdr.len, handlers[cls].arg);
+    handled++;
+  }
+
+  return res == SCEWL_ERR && !handled ? SCEWL_ERR : handled;
+}
+
+
+// write all of the iovecs, resuming after partial writes. Returns SCEWL_OK,
+// or SCEWL_ERR if the socket failed
+static int full_writev(struct iovec *iov, int cnt) {
+  struct pollfd pfd = { .fd = sock, .events = POLLOUT };
+  ssize_t written;
+
+  while (cnt) {
+    written = writev(sock, iov, cnt);
+    if (written < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // wait for room
+        poll(&pfd, 1, -1);
+      } else if (errno != EINTR) {
+        return SCEWL_ERR;
+      }
+      continue;
+    }
+
+    // skip what was written
+    while (cnt && written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      cnt--;
+    }
+    if (cnt) {
+      iov->iov_base = (char *)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
   return SCEWL_OK;
 }
 
 
+// pack a header and the iovecs for it and its body
+static void pack_frame(scewl_hdr_t *hdr, struct iovec *iov,
+                       scewl_id_t tgt_id, uint16_t len, char *data) {
+  hdr->magicS = 'S';
+  hdr->magicC = 'C';
+  hdr->src_id = self_id;
+  hdr->tgt_id = tgt_id;
+  hdr->len    = len;
+
+  iov[0].iov_base = hdr;
+  iov[0].iov_len  = sizeof(*hdr);
+  iov[1].iov_base = data;
+  iov[1].iov_len  = len;
+}
+
+
+static int send_frame(scewl_id_t tgt_id, uint16_t len, char *data) {
+  scewl_hdr_t hdr;
+  struct iovec iov[2];
+
+#ifdef SCEWL_THREADS
+  if (io_running()) {
+    return tx_push(tgt_id, len, data);
+  }
+#endif
+
+  // nothing but the SSS can be sent to before registration completes
+  if (reg.state == SCEWL_PENDING && tgt_id != SCEWL_SSS_ID) {
+    return reg_queue(tgt_id, len, data);
+  }
+
+  // send header and body together
+  pack_frame(&hdr, iov, tgt_id, len, data);
+  return full_writev(iov, 2);
+}
+
+
+static int send_frames(scewl_msg_t *msgs, int n) {
+  scewl_hdr_t hdrs[BATCH_FRAMES];
+  struct iovec iov[2 * BATCH_FRAMES];
+  int cnt;
+
+#ifdef SCEWL_THREADS
+  if (io_running()) {
+    for (int i = 0; i < n; i++) {
+      if (tx_push(msgs[i].tgt_id, msgs[i].len, msgs[i].buf) != SCEWL_OK) {
+        return SCEWL_ERR;
+      }
+    }
+    return SCEWL_OK;
+  }
+#endif
+
+  // queued one by one, see send_frame
+  if (reg.state == SCEWL_PENDING) {
+    for (int i = 0; i < n; i++) {
+      if (send_frame(msgs[i].tgt_id, msgs[i].len, msgs[i].buf) != SCEWL_OK) {
+        return SCEWL_ERR;
+      }
+    }
+    return SCEWL_OK;
+  }
+
+  for (int i = 0; i < n; i += cnt) {
+    cnt = n - i < BATCH_FRAMES ? n - i : BATCH_FRAMES;
+    for (int j = 0; j < cnt; j++) {
+      pack_frame(&hdrs[j], &iov[2 * j], msgs[i + j].tgt_id, msgs[i + j].len, msgs[i + j].buf);
+    }
+    if (full_writev(iov, 2 * cnt) != SCEWL_OK) {
+      return SCEWL_ERR;
+    }
+  }
+  return SCEWL_OK;
+}
+
+
+int scewl_send(scewl_id_t tgt_id, uint16_t len, char *data) {
+  STATS_START(start);
+  int res = send_frame(tgt_id, len, data);
+
+  STATS_TIME(send, start);
+  if (res == SCEWL_OK) {
+    STATS_SENT(tgt_id, len);
+  }
+  return res;
+}
+
+
+int scewl_send_batch(scewl_msg_t *msgs, int n) {
+  int res = send_frames(msgs, n);
+
+  // batches are counted but not timed, as their time is not per message
+  for (int i = 0; res == SCEWL_OK && i < n; i++) {
+    STATS_SENT(msgs[i].tgt_id, msgs[i].len);
+  }
+  return res;
+}
+
+
 int scewl_brdcst(uint16_t len, char *data) {
   scewl_send(SCEWL_BRDCST_ID, len, data);
   return SCEWL_OK;
 }
+
+
+// queue a frame until registration completes, within the same budget as
+// frames held back by scewl_recv_from
+static int reg_queue(scewl_id_t tgt_id, uint16_t len, char *data) {
+  size_t sz = sizeof(scewl_hdr_t) + len;
+  struct iovec iov[2];
+  stashed_t *frame;
+
+  if (reg.bytes + sz > SCEWL_STASH_BUDGET || !(frame = malloc(sizeof(*frame) + len))) {
+    fprintf(logfp, "registration queue full, dropped frame to %d\n", tgt_id);
+    return SCEWL_ERR;
+  }
+  frame->next = NULL;
+  pack_frame(&frame->hdr, iov, tgt_id, len, data);
+  memcpy(frame->body, data, len);
+  reg.bytes += sz;
+
+  if (reg.head) {
+    reg.tail->next = frame;
+  } else {
+    reg.head = frame;
+  }
+  reg.tail = frame;
+  return SCEWL_OK;
+}
+
+
+// send the frames queued while registering, BATCH_FRAMES per writev()
+static int reg_flush() {
+  struct iovec iov[2 * BATCH_FRAMES];
+  stashed_t *frame = reg.head;
+  int cnt;
+
+  while (frame) {
+    for (cnt = 0; frame && cnt < BATCH_FRAMES; frame = frame->next, cnt++) {
+      iov[2 * cnt].iov_base = &frame->hdr;
+      iov[2 * cnt].iov_len = sizeof(frame->hdr);
+      iov[2 * cnt + 1].iov_base = frame->body;
+      iov[2 * cnt + 1].iov_len = frame->hdr.len;
+    }
+    if (full_writev(iov, 2 * cnt) != SCEWL_OK) {
+      return SCEWL_ERR;
+    }
+  }
+  return SCEWL_OK;
+}
+
+
+// finish registering. Queued frames are sent once the device is registered,
+// whether by this request or before it, and dropped if registration failed,
+// as the controller would drop them anyway
+static void reg_complete(int status) {
+  stashed_t *frame;
+
+  if (status != SCEWL_ERR && reg_flush() != SCEWL_OK) {
+    fprintf(logfp, "failed to send messages queued while registering\n");
+  } else if (status == SCEWL_ERR && reg.head) {
+    fprintf(logfp, "registration failed, dropped messages queued meanwhile\n");
+  }
+  while ((frame = reg.head)) {
+    reg.head = frame->next;
+    free(frame);
+  }
+  reg.bytes = 0;
+
+  reg.state = status;
+  if (reg.cb) {
+    reg.cb(status, reg.arg);
+  }
+}
+
+
+// take the frame at the head of the receive buffer if it is the reply to
+// scewl_register_async. Returns 1 if it was
+static int reg_reply(scewl_hdr_t *hdr) {
+  scewl_sss_msg_t msg;
+
+  if (reg.state != SCEWL_PENDING || hdr->src_id != SCEWL_SSS_ID) {
+    return 0;
+  }
+
+  memcpy(&msg, rx.buf + rx.head + sizeof(*hdr), hdr->len < sizeof(msg) ? hdr->len : sizeof(msg));
+  rx.head += sizeof(*hdr) + hdr->len;
+  STATS_RECEIVED(hdr->src_id, hdr->len);
+  STATS_TIME(sss, reg.start);
+
+  reg_complete(reg_status(&msg, hdr->len));
+  return 1;
+}
+
+
+int scewl_register_async(scewl_reg_cb_t cb, void *arg) {
+  scewl_sss_msg_t msg;
+
+#ifdef SCEWL_THREADS
+  // the I/O thread does not look for the reply
+  if (io_running()) {
+    return SCEWL_ERR;
+  }
+#endif
+
+  if (reg.state == SCEWL_PENDING) {
+    return SCEWL_ERR;
+  }
+
+  STATS_MARK(reg.start);
+
+  msg.dev_id = self_id;
+  msg.op = SCEWL_SSS_REG;
+
+  if (scewl_send(SCEWL_SSS_ID, sizeof(msg), (char *)&msg) == SCEWL_ERR) {
+    fprintf(logfp, "failed to register\n");
+    return SCEWL_ERR;
+  }
+
+  reg.cb = cb;
+  reg.arg = arg;
+  reg.state = SCEWL_PENDING;
+  return SCEWL_OK;
+}
+
+
+int scewl_register_status() {
+  scewl_hdr_t hdr;
+  int res = SCEWL_OK;
+
+  // look through what has arrived for the reply, holding back the rest
+  while (reg.state == SCEWL_PENDING && (res = rx_frame(&hdr, 0)) == SCEWL_OK) {
+    if (!reg_reply(&hdr)) {
+      stash_put(&hdr, rx.buf + rx.head + sizeof(hdr));
+      rx.head += sizeof(hdr) + hdr.len;
+    }
+  }
+
+  // the reply can no longer arrive once the socket failed
+  if (reg.state == SCEWL_PENDING && res == SCEWL_ERR) {
+    fprintf(logfp, "failed to register\n");
+    reg_complete(SCEWL_ERR);
+  }
+  return reg.state;
+}
+
+
+void scewl_close() {
+  stashed_t *frame;
+  int q;
+
+  scewl_release();
+  while ((q = stash_find(ANY_SRC)) >= 0) {
+    free(stash_pop(q));
+  }
+  while ((frame = reg.head)) {
+    reg.head = frame->next;
+    free(frame);
+  }
+  reg.bytes = 0;
+  reg.state = SCEWL_ERR;
+
+  close(sock);
+  sock = -1;
+}
+
+
+#ifdef SCEWL_THREADS
+/*
+ * Threaded mode. scewl_start_io hands the socket to an I/O thread:
+ *  - scewl_send pushes frames onto a lock-free multi-producer queue, which
+ *    the I/O thread drains into batched writes
+ *  - the I/O thread copies each received frame to the single-producer,
+ *    single-consumer queue of every subscriber to its class
+ * Each side sleeps on an eventfd. It sets its sleeping flag before checking
+ * for work one last time, and the other side only writes to the eventfd if
+ * it finds the flag set, so wakeups are neither lost nor paid for per frame
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+
+// frames per receive queue
+#define QUEUE_SLOTS 256
+
+// bytes of frames the send queue may hold, after which sends fail until the
+// I/O thread catches up. Can be set at compile time
+#ifndef SCEWL_SEND_BUDGET
+#define SCEWL_SEND_BUDGET 0x10000
+#endif
+
+// frame queued to send or copied out of the receive buffer. The header and
+// body are contiguous, so each frame is written with one iovec
+typedef struct frame_t {
+  struct frame_t *_Atomic next;
+  scewl_hdr_t hdr;
+  char body[];
+} frame_t;
+
+struct scewl_queue_t {
+  unsigned classes;
+  int wake_fd;
+  atomic_int sleeping;
+  atomic_size_t head, tail;  // consumer takes from head, I/O thread adds at tail
+  frame_t *slots[QUEUE_SLOTS];
+  struct scewl_queue_t *next;
+};
+
+static struct {
+  pthread_t thread;
+  atomic_int running, stop;
+  int wake_fd;
+  atomic_int sleeping;
+
+  // send queue. Producers push at head, the I/O thread pops at tail
+  frame_t *_Atomic tx_head;
+  frame_t *tx_tail;
+  atomic_size_t tx_bytes;
+
+  // subscribers, newest first. Never removed
+  scewl_queue_t *_Atomic queues;
+
+  // where delivery of the frame at rx.head stopped on a full queue. Its
+  // consumer wakes the I/O thread once it makes room
+  scewl_queue_t *_Atomic blocked;
+} io;
+
+// placeholder send queue entry, so that the queue is never empty
+static frame_t tx_stub;
+
+
+static int io_running() {
+  return atomic_load(&io.running);
+}
+
+
+// wake a thread that may be about to sleep on fd
+static void wake(atomic_int *sleeping, int fd) {
+  if (atomic_load(sleeping) && atomic_exchange(sleeping, 0)) {
+    eventfd_write(fd, 1);
+  }
+}
+
+
+static int tx_push(scewl_id_t tgt_id, uint16_t len, char *data) {
+  size_t sz = sizeof(frame_t) + len;
+  frame_t *frame, *prev;
+
+  // reserve room in the budget before taking the memory
+  if (atomic_fetch_add(&io.tx_bytes, sz) + sz > SCEWL_SEND_BUDGET) {
+    atomic_fetch_sub(&io.tx_bytes, sz);
+    return SCEWL_ERR;
+  }
+  if (!(frame = malloc(sz))) {
+    atomic_fetch_sub(&io.tx_bytes, sz);
+    return SCEWL_ERR;
+  }
+
+  frame->hdr.magicS = 'S';
+  frame->hdr.magicC = 'C';
+  frame->hdr.src_id = self_id;
+  frame->hdr.tgt_id = tgt_id;
+  frame->hdr.len    = len;
+  memcpy(frame->body, data, len);
+  atomic_store_explicit(&frame->next, NULL, memory_order_relaxed);
+
+  // link in behind the last frame pushed by any thread
+  prev = atomic_exchange(&io.tx_head, frame);
+  atomic_store_explicit(&prev->next, frame, memory_order_release);
+
+  wake(&io.sleeping, io.wake_fd);
+  return SCEWL_OK;
+}
+
+
+// take the oldest frame from the send queue. Returns NULL if it is empty or
+// the next push is only half done
+static frame_t *tx_pop() {
+  frame_t *tail = io.tx_tail, *next, *prev;
+
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if (tail == &tx_stub) {
+    if (!next) {
+      return NULL;
+    }
+    io.tx_tail = tail = next;
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  }
+
+  if (next) {
+    io.tx_tail = next;
+    return tail;
+  }
+  if (tail != atomic_load(&io.tx_head)) {
+    return NULL;
+  }
+
+  // tail is the last frame, queue the stub behind it to take it
+  atomic_store_explicit(&tx_stub.next, NULL, memory_order_relaxed);
+  prev = atomic_exchange(&io.tx_head, &tx_stub);
+  atomic_store_explicit(&prev->next, &tx_stub, memory_order_release);
+
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if (next) {
+    io.tx_tail = next;
+    return tail;
+  }
+  return NULL;
+}
+
+
+// write out everything in the send queue, BATCH_FRAMES frames per call
+static int tx_flush() {
+  frame_t *frames[BATCH_FRAMES];
+  struct iovec iov[BATCH_FRAMES];
+  int cnt, res = SCEWL_OK;
+
+  do {
+    for (cnt = 0; cnt < BATCH_FRAMES && (frames[cnt] = tx_pop()); cnt++) {
+      iov[cnt].iov_base = &frames[cnt]->hdr;
+      iov[cnt].iov_len  = sizeof(scewl_hdr_t) + frames[cnt]->hdr.len;
+    }
+
+    if (cnt && res == SCEWL_OK) {
+      res = full_writev(iov, cnt);
+    }
+    for (int i = 0; i < cnt; i++) {
+      atomic_fetch_sub(&io.tx_bytes, sizeof(frame_t) + frames[i]->hdr.len);
+      free(frames[i]);
+    }
+  } while (cnt == BATCH_FRAMES);
+
+  return res;
+}
+
+
+static int queue_full(scewl_queue_t *q) {
+  return atomic_load(&q->tail) - atomic_load(&q->head) == QUEUE_SLOTS;
+}
+
+
+// copy the frame at rx.head to every subscriber to its class, carrying on
+// from where the last call stopped. Returns 1 once it has reached them all,
+// or 0 if it stopped at a full queue
+static int deliver(scewl_hdr_t *hdr) {
+  scewl_queue_t *q = io.blocked ? io.blocked : atomic_load(&io.queues);
+  unsigned cls = 1 << classify(hdr);
+  frame_t *frame;
+  size_t tail;
+
+  for (; q; q = q->next) {
+    if (!(q->classes & cls)) {
+      continue;
+    }
+    if (queue_full(q)) {
+      io.blocked = q;
+      return 0;
+    }
+
+    frame = malloc(sizeof(*frame) + hdr->len);
+    if (!frame) {
+      fprintf(logfp, "out of memory, dropped frame from %d\n", hdr->src_id);
+      continue;
+    }
+    memcpy(&frame->hdr, rx.buf + rx.head, sizeof(*hdr) + hdr->len);
+
+    tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    q->slots[tail % QUEUE_SLOTS] = frame;
+    atomic_store(&q->tail, tail + 1);
+    wake(&q->sleeping, q->wake_fd);
+  }
+
+  io.blocked = NULL;
+  rx.head += sizeof(*hdr) + hdr->len;
+  return 1;
+}
+
+
+static void *io_thread(void *arg) {
+  struct pollfd pfds[2] = {
+    { .fd = io.wake_fd, .events = POLLIN },
+    { .fd = sock, .events = POLLIN },
+  };
+  scewl_hdr_t hdr;
+  eventfd_t val;
+  int res = SCEWL_OK, stop;
+
+  while (res != SCEWL_ERR) {
+    // look for the stop before flushing, so that everything sent before
+    // scewl_stop_io is written out
+    stop = atomic_load(&io.stop);
+    if (tx_flush() != SCEWL_OK || stop) {
+      break;
+    }
+
+    // deliver everything received so far, unless a subscriber is full
+    while ((res = rx_frame(&hdr, 0)) == SCEWL_OK && deliver(&hdr)) {
+    }
+
+    // sleep until there is something to send, something to receive while
+    // no subscriber is full, or room in the full one
+    atomic_store(&io.sleeping, 1);
+    if (atomic_load(&io.tx_head) == io.tx_tail &&
+        !(io.blocked && !queue_full(io.blocked)) && !atomic_load(&io.stop)) {
+      pfds[1].fd = io.blocked ? -1 : sock;
+      poll(pfds, 2, -1);
+      if (pfds[0].revents) {
+        eventfd_read(io.wake_fd, &val);
+      }
+    }
+    atomic_store(&io.sleeping, 0);
+  }
+
+  if (res == SCEWL_ERR) {
+    fprintf(logfp, "lost connection to the SCEWL Bus Controller\n");
+  }
+
+  // let waiting consumers see that nothing more is coming
+  atomic_store(&io.running, 0);
+  for (scewl_queue_t *q = atomic_load(&io.queues); q; q = q->next) {
+    eventfd_write(q->wake_fd, 1);
+  }
+  return NULL;
+}
+
+
+int scewl_start_io() {
+  // the I/O thread would not look for the reply
+  if (reg.state == SCEWL_PENDING) {
+    return SCEWL_ERR;
+  }
+
+  io.wake_fd = eventfd(0, EFD_NONBLOCK);
+  if (io.wake_fd < 0) {
+    return SCEWL_ERR;
+  }
+
+  io.tx_tail = &tx_stub;
+  atomic_store(&io.tx_head, &tx_stub);
+  atomic_store(&io.tx_bytes, 0);
+  atomic_store(&io.stop, 0);
+  atomic_store(&io.running, 1);
+
+  if (pthread_create(&io.thread, NULL, io_thread, NULL)) {
+    atomic_store(&io.running, 0);
+    close(io.wake_fd);
+    return SCEWL_ERR;
+  }
+  return SCEWL_OK;
+}
+
+
+void scewl_stop_io() {
+  atomic_store(&io.stop, 1);
+  eventfd_write(io.wake_fd, 1);
+  pthread_join(io.thread, NULL);
+  close(io.wake_fd);
+}
+
+
+scewl_queue_t *scewl_subscribe(unsigned classes) {
+  scewl_queue_t *q = calloc(1, sizeof(*q));
+
+  if (!q) {
+    return NULL;
+  }
+  q->classes = classes;
+  q->wake_fd = eventfd(0, EFD_NONBLOCK);
+  if (q->wake_fd < 0) {
+    free(q);
+    return NULL;
+  }
+
+  q->next = atomic_load(&io.queues);
+  while (!atomic_compare_exchange_weak(&io.queues, &q->next, q)) {
+  }
+  return q;
+}
+
+
+int scewl_queue_recv(scewl_queue_t *q, char *buf, scewl_id_t *src_id,
+                     scewl_id_t *tgt_id, size_t n, int timeout_ms) {
+  struct pollfd pfd = { .fd = q->wake_fd, .events = POLLIN };
+  long deadline = timeout_ms > 0 ? now_ms() + timeout_ms : 0, left = -1;
+  size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  frame_t *frame;
+  eventfd_t val;
+  int max;
+  STATS_START(start);
+
+  while (head == atomic_load(&q->tail)) {
+    // nothing more will arrive once the I/O thread stops, even when polling
+    if (!io_running()) {
+      return SCEWL_ERR;
+    }
+    if (!timeout_ms || (timeout_ms > 0 && (left = deadline - now_ms()) <= 0)) {
+      return SCEWL_NO_MSG;
+    }
+
+    atomic_store(&q->sleeping, 1);
+    if (head == atomic_load(&q->tail) && io_running()) {
+      if (poll(&pfd, 1, left) > 0) {
+        eventfd_read(q->wake_fd, &val);
+      }
+    }
+    atomic_store(&q->sleeping, 0);
+  }
+
+  frame = q->slots[head % QUEUE_SLOTS];
+  atomic_store(&q->head, head + 1);
+
+  // the I/O thread may be waiting for room in this queue
+  if (atomic_load(&io.blocked) == q) {
+    wake(&io.sleeping, io.wake_fd);
+  }
+
+  STATS_TIME(recv_wait, start);
+  STATS_RECEIVED(frame->hdr.src_id, frame->hdr.len);
+
+  *src_id = frame->hdr.src_id;
+  *tgt_id = frame->hdr.tgt_id;
+  max = frame->hdr.len < n ? frame->hdr.len : n;
+  memcpy(buf, frame->body, max);
+  if (max < n) {
+    buf[max] = 0;
+  }
+
+  free(frame);
+  return max;
+}
+#endif // SCEWL_THREADS
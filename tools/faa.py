@@ -15,6 +15,9 @@ import logging
 import select
 import cmd
 import os
+import time
+
+import trace_report
 
 INSEC_ID = 2
 
@@ -77,6 +80,51 @@ class FAATransceiver(cmd.Cmd):
         except ValueError:
             print(f'{repr(data)} is not valid hex string')
 
+    def recv(self):
+        # receive and unpack packet header
+        hdr = b''
+        while len(hdr) < 8:
+            hdr += self.sock.recv(8 - len(hdr))
+        _, tgt, src, ln = struct.unpack('<HHHH', hdr)
+
+        # receive packet body
+        data = b''
+        while len(data) < ln:
+            data += self.sock.recv(ln - len(data))
+
+        return src, tgt, data
+
+    def do_trace(self, arg: str):
+        'Read the event trace of a controller built with TRACE: trace 10 [file]'
+        args = arg.split(' ')
+        try:
+            tgt = int(args[0])
+        except ValueError:
+            print('Format: <scewl_id> [file to save the raw trace to]')
+            return False
+
+        self.send(tgt, b'trace')
+
+        # wait for the dump, passing on anything else that arrives meanwhile
+        deadline = time.time() + 5
+        while select.select([self.sock], [], [], max(deadline - time.time(), 0))[0]:
+            src, dst, data = self.recv()
+            if src == tgt and data.startswith(trace_report.MAGIC):
+                break
+            print(f'{src}->{dst} ({len(data)}B): {repr(data)}')
+        else:
+            print(f'no trace from {tgt}, is its controller built with TRACE?')
+            return False
+
+        if len(args) > 1:
+            with open(args[1], 'wb') as f:
+                f.write(data)
+
+        try:
+            trace_report.report(data)
+        except ValueError as e:
+            print(e)
+
     def do_docker(self, arg: str):
         'Run Docker command: e.g. docker ps'
         os.system('docker ' + arg)
@@ -93,16 +141,7 @@ class FAATransceiver(cmd.Cmd):
         # get all queued packets
         msgs = []
         while select.select([self.sock], [], [], 0)[0]:
-            # receive and unpack packet header
-            hdr = b''
-            while len(hdr) < 8:
-                hdr += self.sock.recv(8 - len(hdr))
-            _, tgt, src, ln = struct.unpack('<HHHH', hdr)
-
-            # receive packet body
-            data = b''
-            while len(data) < ln:
-                data += self.sock.recv(ln - len(data))
+            src, tgt, data = self.recv()
             msgs.append(f'{src}->{tgt} ({len(data)}B): {repr(data)}')
 
         if msgs:
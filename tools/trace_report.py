@@ -0,0 +1,116 @@
+# 2021 Collegiate eCTF
+# Controller event trace report
+#
+# (c) 2021 The MITRE Corporation
+#
+# This source file is part of an example system for MITRE's 2021 Embedded System CTF (eCTF).
+# This code is being provided only for educational purposes for the 2021 MITRE eCTF competition,
+# and may not meet MITRE standards for quality. Use this code at your own risk!
+
+import argparse
+import struct
+from collections import defaultdict
+
+# must match controller/trace.h
+MAGIC = b'TRC1'
+SLOTS = 256
+HDR_FMT = '<4sII'
+REC_FMT = '<IBBH'
+EVENTS = ['hdr', 'route', 'crypto_start', 'crypto_end', 'tx_queued', 'tx_done']
+DESTS = ['cpu', 'sss', 'rad', 'drop']
+
+LOG_SZ = struct.calcsize(HDR_FMT) + SLOTS * struct.calcsize(REC_FMT)
+
+
+def parse(raw: bytes):
+    '''Returns the core clock and the events in the ring, oldest first'''
+    if len(raw) < LOG_SZ:
+        raise ValueError(f'trace is {len(raw)}B, expected {LOG_SZ}B')
+
+    magic, hz, count = struct.unpack_from(HDR_FMT, raw)
+    if magic != MAGIC:
+        raise ValueError(f'bad trace magic {magic!r}')
+
+    off = struct.calcsize(HDR_FMT)
+    recs = list(struct.iter_unpack(REC_FMT, raw[off:LOG_SZ]))
+
+    # once the ring wrapped, the oldest event is the next one to be overwritten
+    if count > SLOTS:
+        start = count % SLOTS
+        recs = recs[start:] + recs[:start]
+    else:
+        recs = recs[:count]
+
+    return hz, recs
+
+
+def name(event: int, dest: int) -> str:
+    ev = EVENTS[event] if event < len(EVENTS) else f'ev{event}'
+    return f'{ev}({DESTS[dest] if dest < len(DESTS) else dest})'
+
+
+def breakdown(hz: int, recs):
+    '''Groups the time between consecutive events by the pair of events, and
+    the time from each frame header to the last event before the next one by
+    where the frame was routed'''
+    steps = defaultdict(list)
+    frames = defaultdict(list)
+
+    def us(start, end):
+        return ((end - start) & 0xffffffff) * 1e6 / hz
+
+    for prev, cur in zip(recs, recs[1:]):
+        steps[f'{name(prev[1], prev[2])} -> {name(cur[1], cur[2])}'].append(us(prev[0], cur[0]))
+
+    # [header cycles, last cycles, route] of the frame being followed
+    frame = None
+    for cycles, event, dest, _ in recs:
+        if event == EVENTS.index('hdr'):
+            if frame:
+                frames[frame[2]].append(us(frame[0], frame[1]))
+            frame = [cycles, cycles, '?']
+        elif frame:
+            frame[1] = cycles
+            if event == EVENTS.index('route'):
+                frame[2] = DESTS[dest] if dest < len(DESTS) else str(dest)
+    if frame:
+        frames[frame[2]].append(us(frame[0], frame[1]))
+
+    return steps, frames
+
+
+def table(title: str, rows):
+    print(f'{title:<44} {"n":>5} {"mean us":>10} {"min us":>10} {"max us":>10} {"total us":>11}')
+    for key, us in sorted(rows.items(), key=lambda kv: -sum(kv[1])):
+        print(f'{key:<44} {len(us):>5} {sum(us) / len(us):>10.1f} {min(us):>10.1f} '
+              f'{max(us):>10.1f} {sum(us):>11.1f}')
+
+
+def report(raw: bytes):
+    hz, recs = parse(raw)
+    print(f'{len(recs)} events at {hz / 1e6:g} MHz')
+    if len(recs) < 2:
+        return
+
+    steps, frames = breakdown(hz, recs)
+    table('step', steps)
+    print()
+    table('frame, by route', frames)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('trace', help='Trace dumped by tools/trace.gdb or the FAA `trace` command')
+
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    with open(args.trace, 'rb') as f:
+        report(f.read())
+
+
+if __name__ == '__main__':
+    main()